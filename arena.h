@@ -1,9 +1,26 @@
 // arena.h
 
+// macros:
+//  ARENA_IMPLEMENTATION
+//  ARENA_GROWTH_FACTOR = 2
+//  ARENA_ARRAY_ALIGNMENT = 32
+//  ARENA_COMMIT_SIZE = Kb(64)
+//  ARENA_HUGE_PAGE_SIZE = Mb(2)
+//  ARENA_VIRTUAL_RETAIN = Mb(1)
+//  ARENA_CHUNK_SIZE = Kb(16)
+//  ARENA_SCRATCH_SIZE = Kb(64)
+//  ARENA_RING_MAX = 8
+//  ARENA_STATS -- track usage statistics of arenas, print them with arena_stats_print (uses log.h)
+//
+// include thread.h before arena.h to get the concurrent arena (Arena_concurrent) and the per-thread scratch arenas
+
 #ifndef _ARENA_H
 #define _ARENA_H
 
 #include "common.h"
+#ifdef ARENA_STATS
+  #include "log.h"
+#endif
 
 #ifdef __cplusplus
 extern "C" {
@@ -22,62 +39,995 @@ extern "C" {
   #define ARENA_MEMORY_FREE free
 #endif
 
+#ifndef ARENA_GROWTH_FACTOR
+  #define ARENA_GROWTH_FACTOR 2
+#endif
+
+#ifndef ARENA_ARRAY_ALIGNMENT
+  #define ARENA_ARRAY_ALIGNMENT 32
+#endif
+
+#ifndef ARENA_COMMIT_SIZE
+  #define ARENA_COMMIT_SIZE Kb(64)
+#endif
+
+#ifndef ARENA_HUGE_PAGE_SIZE
+  #define ARENA_HUGE_PAGE_SIZE Mb(2)
+#endif
+
+// how many committed bytes a virtual arena keeps across resets
+#ifndef ARENA_VIRTUAL_RETAIN
+  #define ARENA_VIRTUAL_RETAIN Mb(1)
+#endif
+
+// size of the chunks that threads take from a concurrent arena for their local chunk cache
+#ifndef ARENA_CHUNK_SIZE
+  #define ARENA_CHUNK_SIZE Kb(16)
+#endif
+
+// initial block size of the per-thread scratch arenas, they are chained so they grow when needed
+#ifndef ARENA_SCRATCH_SIZE
+  #define ARENA_SCRATCH_SIZE Kb(64)
+#endif
+
+#define ARENA_SCRATCH_COUNT 2
+
+// most arenas an Arena_ring can rotate through
+#ifndef ARENA_RING_MAX
+  #define ARENA_RING_MAX 8
+#endif
+
+// alignment that malloc would give, used when an arena has to pick the alignment itself
+#define ARENA_DEFAULT_ALIGNMENT (2 * sizeof(void*))
+
+// allocations from a concurrent arena are rounded up to this, so that every allocation is suitably aligned
+#define ARENA_CONCURRENT_ALIGNMENT ARENA_DEFAULT_ALIGNMENT
+
+#ifdef __cplusplus
+  #define ARENA_ALIGNOF(T) alignof(T)
+#else
+  #define ARENA_ALIGNOF(T) _Alignof(T)
+#endif
+
 void* (*arena_memory_malloc)(size_t size)           = ARENA_MEMORY_MALLOC;
 void* (*arena_memory_calloc)(size_t n, size_t size) = ARENA_MEMORY_CALLOC;
 void* (*arena_memory_realloc)(void* p, size_t size) = ARENA_MEMORY_REALLOC;
 void (*arena_memory_free)(void* p)                  = ARENA_MEMORY_FREE;
 
+typedef enum Arena_flag {
+  ARENA_FIXED   = 0,
+  ARENA_CHAINED = 1 << 0, // take a new block when the current one is full
+  ARENA_VIRTUAL = 1 << 1, // reserve address space up front and commit pages as the arena grows
+  ARENA_HUGE_PAGES = 1 << 2, // back a virtual arena with huge pages if possible
+  ARENA_MAPPED = 1 << 3, // snapshot mapped from a file, the contents are fixed
+} Arena_flag;
+
+#define ARENA_STATS_BUCKET_COUNT 16
+
+typedef struct Arena_stats {
+  size_t peak;          // highest number of bytes in use at once, including alignment padding and unused block tails
+  size_t alloc_count;
+  size_t failed_count;
+  size_t reset_count;
+  size_t histogram[ARENA_STATS_BUCKET_COUNT]; // allocation sizes, bucket i counts sizes in [2^i, 2^(i+1)), the last bucket counts everything above
+  size_t base;          // bytes in the blocks before the current one (chained arenas only)
+} Arena_stats;
+
+// header of a block in a chained arena, the block data follows directly after it
+typedef struct Arena_block {
+  struct Arena_block* next;
+  size_t size;
+} Arena_block;
+
 typedef struct Arena {
   u8* data;
   size_t index;
   size_t size;
+  Arena_block* block;  // current block (chained arenas only)
+  Arena_block* blocks; // first block (chained arenas only)
+  size_t reserved;     // reserved address space (virtual arenas only), size is the number of committed bytes
+  size_t retain;       // committed bytes to keep on reset (virtual arenas only)
+  u32 flags;
+#ifdef ARENA_STATS
+  Arena_stats stats;
+#endif
 } Arena;
 
+#define ARENA_SNAPSHOT_MAGIC 0x6e657261 // "aren"
+#define ARENA_SNAPSHOT_VERSION 2
+#define ARENA_SNAPSHOT_HEADER_SIZE Kb(64) // the largest supported page size, so that the mapped arena data is page aligned
+
+typedef struct Arena_snapshot_header {
+  u32 magic;
+  u32 version;
+  u64 size;
+  u64 header_size; // ARENA_SNAPSHOT_HEADER_SIZE of the writer, a load with another value fails
+} Arena_snapshot_header;
+
+// self-relative pointer, stays valid when the arena is mapped at another address. 0 is the null pointer
+typedef i64 Arena_offset;
+
+// position in an arena that can be restored to, for using the arena like a stack
+typedef struct Arena_mark {
+  Arena_block* block;
+  size_t index;
+} Arena_mark;
+
 COMMON_PUBLICDEC Arena arena_new(const size_t size);
+COMMON_PUBLICDEC Arena arena_new_chained(const size_t size);
+COMMON_PUBLICDEC Arena arena_new_virtual(const size_t reserve, u32 flags);
 COMMON_PUBLICDEC void* arena_alloc(Arena* arena, const size_t size);
+COMMON_PUBLICDEC void* arena_alloc_aligned(Arena* arena, const size_t size, const size_t align);
+COMMON_PUBLICDEC void* arena_alloc_cacheline(Arena* arena, const size_t size);
+COMMON_PUBLICDEC void* arena_resize(Arena* arena, void* p, const size_t old_size, const size_t new_size);
+COMMON_PUBLICDEC Arena_mark arena_mark(Arena* arena);
+COMMON_PUBLICDEC void arena_restore(Arena* arena, Arena_mark mark);
 COMMON_PUBLICDEC void arena_reset(Arena* arena);
 COMMON_PUBLICDEC void arena_free(Arena* arena);
+// ring of arenas that rotate at every frame or batch boundary. what was allocated in a frame stays valid for the
+// next count - 1 frames, and the oldest arena is reset when the ring rotates onto it
+typedef struct Arena_ring {
+  Arena arenas[ARENA_RING_MAX];
+  size_t count;
+  size_t current;
+  size_t frame; // number of rotations
+} Arena_ring;
+
+COMMON_PUBLICDEC Arena_ring arena_ring_new(const size_t count, const size_t size);
+COMMON_PUBLICDEC Arena* arena_ring_current(Arena_ring* ring);
+COMMON_PUBLICDEC Arena* arena_ring_previous(Arena_ring* ring, const size_t age);
+COMMON_PUBLICDEC Arena* arena_ring_rotate(Arena_ring* ring);
+COMMON_PUBLICDEC void* arena_ring_alloc(Arena_ring* ring, const size_t size);
+COMMON_PUBLICDEC void arena_ring_free(Arena_ring* ring);
+COMMON_PUBLICDEC void arena_offset_set(Arena_offset* offset, void* p);
+COMMON_PUBLICDEC void* arena_offset_get(Arena_offset* offset);
+COMMON_PUBLICDEC Result arena_snapshot_save(Arena* arena, const char* path);
+COMMON_PUBLICDEC Arena arena_snapshot_load(const char* path, bool copy_on_write);
+#ifdef ARENA_STATS
+COMMON_PUBLICDEC void arena_stats_print(i32 fd, const char* name, Arena* arena);
+#endif
+
+// typed helpers, arrays are aligned to at least ARENA_ARRAY_ALIGNMENT so that they can be used directly with aligned simd loads
+#define arena_alloc_type(ARENA, T) ((T*)arena_alloc_aligned(ARENA, sizeof(T), ARENA_ALIGNOF(T)))
+#define arena_alloc_array(ARENA, T, COUNT) ((T*)arena_alloc_aligned(ARENA, (COUNT) * sizeof(T), MAX(ARENA_ARRAY_ALIGNMENT, ARENA_ALIGNOF(T))))
+
+#ifdef _THREAD_H
+
+// arena that can be allocated from by many threads at once without any locking
+// the shared counter is padded on both sides, so its cache line holds nothing else however the struct itself is aligned
+typedef struct Arena_concurrent {
+  u8 padding_before[CACHELINESIZE];
+  volatile size_t index;
+  u8 padding_after[CACHELINESIZE - sizeof(size_t)];
+  u8* data;
+  size_t size;
+  volatile size_t generation; // incremented on reset, invalidates the chunks that threads hold on to
+} Arena_concurrent;
+
+// thread-local cache of a concurrent arena, threads bump allocate from their own chunk and only touch the shared counter when it runs out
+typedef struct Arena_chunk {
+  u8* data;
+  size_t index;
+  size_t size;
+  size_t generation;
+} Arena_chunk;
+
+COMMON_PUBLICDEC Arena_concurrent arena_concurrent_new(const size_t size);
+COMMON_PUBLICDEC void* arena_concurrent_alloc(Arena_concurrent* arena, const size_t size);
+COMMON_PUBLICDEC void arena_concurrent_reset(Arena_concurrent* arena);
+COMMON_PUBLICDEC void arena_concurrent_free(Arena_concurrent* arena);
+COMMON_PUBLICDEC Arena_chunk arena_chunk_new(void);
+COMMON_PUBLICDEC void* arena_chunk_alloc(Arena_concurrent* arena, Arena_chunk* chunk, const size_t size);
+
+// scratch arenas are freed from a thread exit hook, which needs pthread keys or fiber local storage
+#if defined(TARGET_LINUX) || defined(TARGET_APPLE) || defined(TARGET_WINDOWS)
+
+// temporary memory borrowed from one of the calling thread's scratch arenas, give it back with arena_scratch_end
+typedef struct Arena_scratch {
+  Arena* arena;
+  Arena_mark mark;
+} Arena_scratch;
+
+COMMON_PUBLICDEC Arena_scratch arena_scratch_begin(Arena* conflict);
+COMMON_PUBLICDEC void arena_scratch_end(Arena_scratch scratch);
+COMMON_PUBLICDEC void arena_scratch_free(void);
+
+#endif
+
+#endif // _THREAD_H
+
+#ifdef __cplusplus
+}
+#endif
 
 #endif // _ARENA_H
 
 #ifdef ARENA_IMPLEMENTATION
 
+#include <fcntl.h> // open
+#include <sys/stat.h> // fstat
+
+#if defined(TARGET_LINUX) || defined(TARGET_APPLE)
+  #include <sys/mman.h> // mmap, mprotect, madvise, munmap
+#endif
+
+#ifdef TARGET_WINDOWS
+  #define ARENA_OPEN_FLAGS O_BINARY
+#else
+  #define ARENA_OPEN_FLAGS 0
+#endif
+
+#ifdef ARENA_STATS
+  #define ARENA_STATS_ALLOC(ARENA, SIZE) arena_stats_alloc(ARENA, SIZE)
+  #define ARENA_STATS_FAIL(ARENA) ((ARENA)->stats.failed_count += 1)
+  #define ARENA_STATS_RESET(ARENA) ((ARENA)->stats.reset_count += 1)
+  static void arena_stats_alloc(Arena* arena, const size_t size);
+#else
+  #define ARENA_STATS_ALLOC(ARENA, SIZE)
+  #define ARENA_STATS_FAIL(ARENA)
+  #define ARENA_STATS_RESET(ARENA)
+#endif
+
+static Arena_block* arena_block_new(const size_t size);
+static void arena_use_block(Arena* arena, Arena_block* block);
+static bool arena_grow_chained(Arena* arena, const size_t size);
+static bool arena_commit(Arena* arena, const size_t size);
+static bool arena_grow(Arena* arena, const size_t size);
+static void* arena_vm_reserve(size_t size, u32* flags);
+static bool arena_vm_commit(void* p, size_t size);
+static void arena_vm_decommit(void* p, size_t size);
+static void arena_vm_release(void* p, size_t size);
+
+Arena_block* arena_block_new(const size_t size) {
+  Arena_block* block = (Arena_block*)arena_memory_malloc(sizeof(Arena_block) + size);
+  if (!block) {
+    return NULL;
+  }
+  block->next = NULL;
+  block->size = size;
+  return block;
+}
+
+void arena_use_block(Arena* arena, Arena_block* block) {
+  arena->block = block;
+  arena->data = (u8*)(block + 1);
+  arena->index = 0;
+  arena->size = block->size;
+#ifdef ARENA_STATS
+  arena->stats.base = 0;
+  for (Arena_block* it = arena->blocks; it && it != block; it = it->next) {
+    arena->stats.base += it->size;
+  }
+#endif
+}
+
+// move on to the next block in the chain, or insert a new one if the next block is too small.
+// blocks that were kept by arena_reset are reused before any new memory is requested
+bool arena_grow_chained(Arena* arena, const size_t size) {
+  Arena_block* block = arena->block;
+  Arena_block* next = block->next;
+  if (next && next->size >= size) {
+    arena_use_block(arena, next);
+    return true;
+  }
+  size_t new_size = MAX(block->size * ARENA_GROWTH_FACTOR, size);
+  Arena_block* new_block = arena_block_new(new_size);
+  if (!new_block) {
+    return false;
+  }
+  new_block->next = next;
+  block->next = new_block;
+  arena_use_block(arena, new_block);
+  return true;
+}
+
+// make sure that at least size bytes are committed in a virtual arena
+bool arena_commit(Arena* arena, const size_t size) {
+  if (size > arena->reserved) {
+    return false;
+  }
+  size_t granularity = (arena->flags & ARENA_HUGE_PAGES) ? ARENA_HUGE_PAGE_SIZE : ARENA_COMMIT_SIZE;
+  size_t new_size = MIN(ALIGN(size, granularity), arena->reserved);
+  if (!arena_vm_commit(&arena->data[arena->size], new_size - arena->size)) {
+    return false;
+  }
+  arena->size = new_size;
+  return true;
+}
+
+bool arena_grow(Arena* arena, const size_t size) {
+  if (arena->flags & ARENA_CHAINED) {
+    return arena_grow_chained(arena, size);
+  }
+  if (arena->flags & ARENA_VIRTUAL) {
+    return arena_commit(arena, arena->index + size);
+  }
+  return false;
+}
+
+#if defined(TARGET_LINUX) || defined(TARGET_APPLE)
+
+void* arena_vm_reserve(size_t size, u32* flags) {
+  i32 map_flags = MAP_PRIVATE | MAP_ANONYMOUS;
+#ifdef MAP_NORESERVE
+  map_flags |= MAP_NORESERVE;
+#endif
+  void* p = MAP_FAILED;
+  if (*flags & ARENA_HUGE_PAGES) {
+#ifdef MAP_HUGETLB
+    // only works if the system has enough reserved huge pages, fall back to transparent huge pages otherwise.
+    // MAP_NORESERVE is left out on purpose, the fault on a missing huge page would be a SIGBUS
+    p = mmap(NULL, size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (p != MAP_FAILED) {
+      return p;
+    }
+#endif
+#ifdef MADV_HUGEPAGE
+    // over-reserve so that the range can be aligned to the huge page size
+    u8* base = (u8*)mmap(NULL, size + ARENA_HUGE_PAGE_SIZE, PROT_NONE, map_flags, -1, 0);
+    if ((void*)base == MAP_FAILED) {
+      return NULL;
+    }
+    u8* aligned = (u8*)ALIGN((uintptr_t)base, ARENA_HUGE_PAGE_SIZE);
+    if (aligned > base) {
+      munmap(base, aligned - base);
+    }
+    if (aligned < base + ARENA_HUGE_PAGE_SIZE) {
+      munmap(aligned + size, (base + ARENA_HUGE_PAGE_SIZE) - aligned);
+    }
+    madvise(aligned, size, MADV_HUGEPAGE);
+    return aligned;
+#else
+    *flags &= ~ARENA_HUGE_PAGES;
+#endif
+  }
+  p = mmap(NULL, size, PROT_NONE, map_flags, -1, 0);
+  return p != MAP_FAILED ? p : NULL;
+}
+
+bool arena_vm_commit(void* p, size_t size) {
+  return mprotect(p, size, PROT_READ | PROT_WRITE) == 0;
+}
+
+void arena_vm_decommit(void* p, size_t size) {
+  madvise(p, size, MADV_DONTNEED);
+  mprotect(p, size, PROT_NONE);
+}
+
+void arena_vm_release(void* p, size_t size) {
+  munmap(p, size);
+}
+
+#elif defined(TARGET_WINDOWS)
+
+void* arena_vm_reserve(size_t size, u32* flags) {
+  *flags &= ~ARENA_HUGE_PAGES; // large pages require special privileges on windows
+  return VirtualAlloc(NULL, size, MEM_RESERVE, PAGE_NOACCESS);
+}
+
+bool arena_vm_commit(void* p, size_t size) {
+  return VirtualAlloc(p, size, MEM_COMMIT, PAGE_READWRITE) != NULL;
+}
+
+void arena_vm_decommit(void* p, size_t size) {
+  VirtualFree(p, size, MEM_DECOMMIT);
+}
+
+void arena_vm_release(void* p, size_t size) {
+  (void)size;
+  VirtualFree(p, 0, MEM_RELEASE);
+}
+
+#else
+
+// no virtual memory (e.g. wasm), the whole reservation is taken from the heap up front so committing always succeeds
+void* arena_vm_reserve(size_t size, u32* flags) {
+  *flags &= ~ARENA_HUGE_PAGES;
+  return arena_memory_malloc(size);
+}
+
+bool arena_vm_commit(void* p, size_t size) {
+  (void)size;
+  return p != NULL;
+}
+
+// heap memory can not be handed back in parts, the pages stay in use until the arena is released
+void arena_vm_decommit(void* p, size_t size) {
+  (void)p;
+  (void)size;
+}
+
+void arena_vm_release(void* p, size_t size) {
+  (void)size;
+  arena_memory_free(p);
+}
+
+#endif
+
 COMMON_PUBLICDEF
 Arena arena_new(const size_t size) {
   Arena arena = {
     .data = (u8*)arena_memory_malloc(size),
     .index = 0,
     .size = size,
+    .block = NULL,
+    .blocks = NULL,
+    .reserved = 0,
+    .retain = 0,
+    .flags = ARENA_FIXED,
   };
   ASSERT(arena.data != NULL && "out of memory");
   return arena;
 }
 
+COMMON_PUBLICDEF
+Arena arena_new_chained(const size_t size) {
+  ASSERT(size > 0);
+  Arena arena = {
+    .data = NULL,
+    .index = 0,
+    .size = 0,
+    .block = NULL,
+    .blocks = arena_block_new(size),
+    .reserved = 0,
+    .retain = 0,
+    .flags = ARENA_CHAINED,
+  };
+  ASSERT(arena.blocks != NULL && "out of memory");
+  arena_use_block(&arena, arena.blocks);
+  return arena;
+}
+
+// reserve address space for the whole arena, pages are committed lazily so pointers stay valid as it grows.
+// flags may contain ARENA_HUGE_PAGES
+COMMON_PUBLICDEF
+Arena arena_new_virtual(const size_t reserve, u32 flags) {
+  ASSERT(reserve > 0);
+  flags = (flags & ARENA_HUGE_PAGES) | ARENA_VIRTUAL;
+  size_t granularity = (flags & ARENA_HUGE_PAGES) ? ARENA_HUGE_PAGE_SIZE : ARENA_COMMIT_SIZE;
+  size_t reserved = ALIGN(reserve, granularity);
+  Arena arena = {
+    .data = (u8*)arena_vm_reserve(reserved, &flags),
+    .index = 0,
+    .size = 0,
+    .block = NULL,
+    .blocks = NULL,
+    .reserved = reserved,
+    .retain = ARENA_VIRTUAL_RETAIN,
+    .flags = flags,
+  };
+  ASSERT(arena.data != NULL && "failed to reserve memory");
+  return arena;
+}
+
 COMMON_PUBLICDEF
 void* arena_alloc(Arena* arena, const size_t size) {
   ASSERT(arena != NULL);
   if (arena->index + size <= arena->size) {
     void* p = (void*)&arena->data[arena->index];
     arena->index += size;
+    ARENA_STATS_ALLOC(arena, size);
+    return p;
+  }
+  if (arena->flags != ARENA_FIXED && arena_grow(arena, size)) {
+    void* p = (void*)&arena->data[arena->index];
+    arena->index += size;
+    ARENA_STATS_ALLOC(arena, size);
     return p;
   }
+  ARENA_STATS_FAIL(arena);
   return NULL;
 }
 
+// align must be a power of two, the alignment is of the returned address and not of the offset into the arena
+COMMON_PUBLICDEF
+void* arena_alloc_aligned(Arena* arena, const size_t size, const size_t align) {
+  ASSERT(arena != NULL);
+  ASSERT(align > 0 && (align & (align - 1)) == 0 && "alignment must be a power of two");
+  uintptr_t address = (uintptr_t)&arena->data[arena->index];
+  size_t padding = (align - (address & (align - 1))) & (align - 1);
+  if (arena->index + padding + size <= arena->size) {
+    void* p = (void*)&arena->data[arena->index + padding];
+    arena->index += padding + size;
+    ARENA_STATS_ALLOC(arena, size);
+    return p;
+  }
+  if (arena->flags != ARENA_FIXED && arena_grow(arena, size + align - 1)) {
+    address = (uintptr_t)&arena->data[arena->index];
+    padding = (align - (address & (align - 1))) & (align - 1);
+    void* p = (void*)&arena->data[arena->index + padding];
+    arena->index += padding + size;
+    ARENA_STATS_ALLOC(arena, size);
+    return p;
+  }
+  ARENA_STATS_FAIL(arena);
+  return NULL;
+}
+
+COMMON_PUBLICDEF
+void* arena_alloc_cacheline(Arena* arena, const size_t size) {
+  return arena_alloc_aligned(arena, size, CACHELINESIZE);
+}
+
+// grow or shrink an allocation. if it is the most recent allocation of the arena it is resized in place,
+// otherwise the contents are copied to a new allocation and the old one is left as it is
+COMMON_PUBLICDEF
+void* arena_resize(Arena* arena, void* p, const size_t old_size, const size_t new_size) {
+  ASSERT(arena != NULL);
+  if (!p) {
+    return arena_alloc_aligned(arena, new_size, ARENA_DEFAULT_ALIGNMENT);
+  }
+  u8* end = &arena->data[arena->index];
+  if ((u8*)p + old_size == end && (u8*)p >= arena->data) {
+    size_t start = arena->index - old_size;
+    if (new_size <= old_size) {
+      arena->index = start + new_size;
+      return p;
+    }
+    if (start + new_size <= arena->size || ((arena->flags & ARENA_VIRTUAL) && arena_commit(arena, start + new_size))) {
+      arena->index = start + new_size;
+#ifdef ARENA_STATS
+      arena->stats.peak = MAX(arena->stats.peak, arena->stats.base + arena->index);
+#endif
+      return p;
+    }
+  }
+  else if (new_size <= old_size) {
+    return p;
+  }
+  void* new_p = arena_alloc_aligned(arena, new_size, ARENA_DEFAULT_ALIGNMENT);
+  if (new_p) {
+    memcpy(new_p, p, MIN(old_size, new_size));
+  }
+  return new_p;
+}
+
+COMMON_PUBLICDEF
+Arena_mark arena_mark(Arena* arena) {
+  ASSERT(arena != NULL);
+  return (Arena_mark) {
+    .block = arena->block,
+    .index = arena->index,
+  };
+}
+
+// release everything that was allocated after the mark was taken, blocks of chained arenas are kept for reuse
+COMMON_PUBLICDEF
+void arena_restore(Arena* arena, Arena_mark mark) {
+  ASSERT(arena != NULL);
+  if (arena->flags & ARENA_CHAINED) {
+    ASSERT(mark.block != NULL);
+    arena_use_block(arena, mark.block);
+  }
+  ASSERT(mark.index <= arena->size);
+  arena->index = mark.index;
+}
+
 COMMON_PUBLICDEF
 void arena_reset(Arena* arena) {
+  ARENA_STATS_RESET(arena);
+  if (arena->flags & ARENA_MAPPED) {
+    return;
+  }
+  if (arena->flags & ARENA_CHAINED) {
+    // keep all blocks around so that they can be reused
+    arena_use_block(arena, arena->blocks);
+    return;
+  }
+  if (arena->flags & ARENA_VIRTUAL) {
+    // give pages above the high-water mark back to the system
+    size_t granularity = (arena->flags & ARENA_HUGE_PAGES) ? ARENA_HUGE_PAGE_SIZE : ARENA_COMMIT_SIZE;
+    size_t retain = MIN(ALIGN(arena->retain, granularity), arena->reserved);
+    if (arena->size > retain) {
+      arena_vm_decommit(&arena->data[retain], arena->size - retain);
+      arena->size = retain;
+    }
+  }
   arena->index = 0;
 }
 
 COMMON_PUBLICDEF
 void arena_free(Arena* arena) {
+  ASSERT(arena != NULL);
+  if (arena->flags & ARENA_CHAINED) {
+    Arena_block* block = arena->blocks;
+    while (block) {
+      Arena_block* next = block->next;
+      arena_memory_free(block);
+      block = next;
+    }
+    arena->blocks = NULL;
+    arena->block = NULL;
+  }
+  else if (arena->flags & ARENA_VIRTUAL) {
+    arena_vm_release(arena->data, arena->reserved);
+    arena->reserved = 0;
+  }
+  else if (arena->flags & ARENA_MAPPED) {
+#if defined(TARGET_LINUX) || defined(TARGET_APPLE)
+    munmap(arena->data - ARENA_SNAPSHOT_HEADER_SIZE, arena->reserved);
+#endif
+    arena->reserved = 0;
+  }
+  else {
+    arena_memory_free(arena->data);
+  }
+  arena->data = NULL;
+  arena->index = 0;
+  arena->size = 0;
+}
+
+// the arenas are chained, so a frame that needs more than size bytes does not fail
+COMMON_PUBLICDEF
+Arena_ring arena_ring_new(const size_t count, const size_t size) {
+  ASSERT(count > 0 && count <= ARENA_RING_MAX);
+  Arena_ring ring = {
+    .arenas = {{0}},
+    .count = count,
+    .current = 0,
+    .frame = 0,
+  };
+  for (size_t i = 0; i < count; ++i) {
+    ring.arenas[i] = arena_new_chained(size);
+  }
+  return ring;
+}
+
+COMMON_PUBLICDEF
+Arena* arena_ring_current(Arena_ring* ring) {
+  ASSERT(ring != NULL);
+  return &ring->arenas[ring->current];
+}
+
+// arena of the frame that came age frames before the current one, age must be less than the number of arenas
+COMMON_PUBLICDEF
+Arena* arena_ring_previous(Arena_ring* ring, const size_t age) {
+  ASSERT(ring != NULL);
+  ASSERT(age < ring->count && "frame is no longer alive");
+  return &ring->arenas[(ring->current + ring->count - age) % ring->count];
+}
+
+// move on to the next frame, the oldest arena is reset and becomes the current one
+COMMON_PUBLICDEF
+Arena* arena_ring_rotate(Arena_ring* ring) {
+  ASSERT(ring != NULL);
+  ring->current = (ring->current + 1) % ring->count;
+  ring->frame += 1;
+  Arena* arena = &ring->arenas[ring->current];
+  arena_reset(arena);
+  return arena;
+}
+
+COMMON_PUBLICDEF
+void* arena_ring_alloc(Arena_ring* ring, const size_t size) {
+  return arena_alloc_aligned(arena_ring_current(ring), size, ARENA_DEFAULT_ALIGNMENT);
+}
+
+COMMON_PUBLICDEF
+void arena_ring_free(Arena_ring* ring) {
+  ASSERT(ring != NULL);
+  for (size_t i = 0; i < ring->count; ++i) {
+    arena_free(&ring->arenas[i]);
+  }
+  ring->count = 0;
+  ring->current = 0;
+}
+
+COMMON_PUBLICDEF
+void arena_offset_set(Arena_offset* offset, void* p) {
+  *offset = p ? (Arena_offset)((u8*)p - (u8*)offset) : 0;
+}
+
+COMMON_PUBLICDEF
+void* arena_offset_get(Arena_offset* offset) {
+  return *offset ? (void*)((u8*)offset + *offset) : NULL;
+}
+
+// write the used part of an arena to a file. pointers inside the arena must be stored as Arena_offset for the
+// snapshot to be usable. alignment is kept up to the alignment of the arena data itself and at most up to the page size
+// of the system that loads it, which is a page for virtual arenas. chained arenas can only be saved while they use a
+// single block
+COMMON_PUBLICDEF
+Result arena_snapshot_save(Arena* arena, const char* path) {
+  ASSERT(arena != NULL);
+  if ((arena->flags & ARENA_CHAINED) && arena->block != arena->blocks) {
+    return Error;
+  }
+  i32 fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | ARENA_OPEN_FLAGS, 0644);
+  if (fd < 0) {
+    return Error;
+  }
+  Result result = Ok;
+  u8* page = (u8*)arena_memory_calloc(1, ARENA_SNAPSHOT_HEADER_SIZE);
+  if (!page) {
+    return_defer(Error);
+  }
+  Arena_snapshot_header header = {
+    .magic = ARENA_SNAPSHOT_MAGIC,
+    .version = ARENA_SNAPSHOT_VERSION,
+    .size = arena->index,
+    .header_size = ARENA_SNAPSHOT_HEADER_SIZE,
+  };
+  memcpy(page, &header, sizeof(header));
+  const u8* chunks[2] = { page, arena->data };
+  size_t sizes[2] = { ARENA_SNAPSHOT_HEADER_SIZE, arena->index };
+  for (size_t i = 0; i < LENGTH(chunks); ++i) {
+    size_t written = 0;
+    // write may return before everything is written
+    while (written < sizes[i]) {
+      i64 n = write(fd, chunks[i] + written, sizes[i] - written);
+      if (n <= 0) {
+        return_defer(Error);
+      }
+      written += n;
+    }
+  }
+defer:
+  arena_memory_free(page);
+  close(fd);
+  return result;
+}
+
+// map a snapshot that was written by arena_snapshot_save, pages are loaded lazily as they are touched.
+// with copy_on_write the arena can be modified in place without changing the file, otherwise it is read-only.
+// on failure the returned arena has no data
+COMMON_PUBLICDEF
+Arena arena_snapshot_load(const char* path, bool copy_on_write) {
+  Arena arena = {0};
+  Arena_snapshot_header header = {0};
+  i32 fd = open(path, O_RDONLY | ARENA_OPEN_FLAGS);
+  if (fd < 0) {
+    return arena;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || (size_t)st.st_size < ARENA_SNAPSHOT_HEADER_SIZE) {
+    close(fd);
+    return arena;
+  }
+  if (read(fd, &header, sizeof(header)) != sizeof(header) ||
+    header.magic != ARENA_SNAPSHOT_MAGIC ||
+    header.version != ARENA_SNAPSHOT_VERSION ||
+    header.header_size != ARENA_SNAPSHOT_HEADER_SIZE ||
+    header.size != (u64)st.st_size - ARENA_SNAPSHOT_HEADER_SIZE) {
+    close(fd);
+    return arena;
+  }
+  size_t size = (size_t)header.size;
+#if defined(TARGET_LINUX) || defined(TARGET_APPLE)
+  i32 prot = copy_on_write ? (PROT_READ | PROT_WRITE) : PROT_READ;
+  u8* base = (u8*)mmap(NULL, ARENA_SNAPSHOT_HEADER_SIZE + size, prot, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if ((void*)base == MAP_FAILED) {
+    return arena;
+  }
+  arena.data = base + ARENA_SNAPSHOT_HEADER_SIZE;
+  arena.index = size;
+  arena.size = size;
+  arena.reserved = ARENA_SNAPSHOT_HEADER_SIZE + size;
+  arena.flags = ARENA_MAPPED;
+#else
+  // no mmap, read the snapshot into a fixed arena instead
+  (void)copy_on_write;
+  arena = arena_new(MAX(size, 1));
+  lseek(fd, ARENA_SNAPSHOT_HEADER_SIZE, SEEK_SET);
+  size_t bytes_read = 0;
+  while (bytes_read < size) {
+    i64 n = read(fd, arena.data + bytes_read, size - bytes_read);
+    if (n <= 0) {
+      arena_free(&arena);
+      close(fd);
+      return arena;
+    }
+    bytes_read += n;
+  }
+  arena.index = size;
+  close(fd);
+#endif
+  return arena;
+}
+
+#ifdef ARENA_STATS
+
+void arena_stats_alloc(Arena* arena, const size_t size) {
+  Arena_stats* stats = &arena->stats;
+  stats->alloc_count += 1;
+  stats->peak = MAX(stats->peak, stats->base + arena->index);
+  size_t bucket = 0;
+  for (size_t n = size; n > 1 && bucket < ARENA_STATS_BUCKET_COUNT - 1; n >>= 1) {
+    bucket += 1;
+  }
+  stats->histogram[bucket] += 1;
+}
+
+COMMON_PUBLICDEF
+void arena_stats_print(i32 fd, const char* name, Arena* arena) {
+  ASSERT(arena != NULL);
+  Arena_stats* stats = &arena->stats;
+  log_print(fd, LOG_TAG_INFO, "arena %s: peak %zu bytes, %zu allocations, %zu failed, %zu resets\n", name, stats->peak, stats->alloc_count, stats->failed_count, stats->reset_count);
+  for (size_t i = 0; i < ARENA_STATS_BUCKET_COUNT; ++i) {
+    continue_if(stats->histogram[i] == 0);
+    size_t low = i == 0 ? 0 : (size_t)1 << i;
+    if (i == ARENA_STATS_BUCKET_COUNT - 1) {
+      log_print(fd, LOG_TAG_NONE, "  [%zu, ...) bytes: %zu\n", low, stats->histogram[i]);
+    }
+    else {
+      log_print(fd, LOG_TAG_NONE, "  [%zu, %zu) bytes: %zu\n", low, (size_t)2 << i, stats->histogram[i]);
+    }
+  }
+}
+
+#endif // ARENA_STATS
+
+#ifdef _THREAD_H
+
+COMMON_PUBLICDEF
+Arena_concurrent arena_concurrent_new(const size_t size) {
+  Arena_concurrent arena = {
+    .padding_before = {0},
+    .index = 0,
+    .padding_after = {0},
+    .data = (u8*)arena_memory_malloc(size),
+    .size = size,
+    .generation = 0,
+  };
+  ASSERT(arena.data != NULL && "out of memory");
+  return arena;
+}
+
+COMMON_PUBLICDEF
+void* arena_concurrent_alloc(Arena_concurrent* arena, const size_t size) {
+  ASSERT(arena != NULL);
+  size_t aligned_size = ALIGN(size, ARENA_CONCURRENT_ALIGNMENT);
+  size_t index = atomic_fetch_add(&arena->index, aligned_size);
+  if (index + aligned_size <= arena->size) {
+    return (void*)&arena->data[index];
+  }
+  // the index is left past the end, so every allocation after this fails as well
+  return NULL;
+}
+
+// must not be called while other threads are allocating from the arena
+COMMON_PUBLICDEF
+void arena_concurrent_reset(Arena_concurrent* arena) {
+  atomic_fetch_add(&arena->generation, 1);
+  atomic_store(&arena->index, 0);
+}
+
+COMMON_PUBLICDEF
+void arena_concurrent_free(Arena_concurrent* arena) {
   ASSERT(arena != NULL);
   arena_memory_free(arena->data);
+  arena->data = NULL;
   arena->index = 0;
   arena->size = 0;
 }
 
-#endif // ARENA_IMPLEMENTATION
-#ifdef __cplusplus
+COMMON_PUBLICDEF
+Arena_chunk arena_chunk_new(void) {
+  return (Arena_chunk) {
+    .data = NULL,
+    .index = 0,
+    .size = 0,
+    .generation = 0,
+  };
+}
+
+COMMON_PUBLICDEF
+void* arena_chunk_alloc(Arena_concurrent* arena, Arena_chunk* chunk, const size_t size) {
+  ASSERT(arena != NULL && chunk != NULL);
+  size_t aligned_size = ALIGN(size, ARENA_CONCURRENT_ALIGNMENT);
+  if (LIKELY(chunk->index + aligned_size <= chunk->size && chunk->generation == arena->generation)) {
+    void* p = (void*)&chunk->data[chunk->index];
+    chunk->index += aligned_size;
+    return p;
+  }
+  // whatever is left in the old chunk is abandoned
+  size_t chunk_size = MAX(ARENA_CHUNK_SIZE, aligned_size);
+  size_t generation = atomic_load(&arena->generation);
+  u8* data = (u8*)arena_concurrent_alloc(arena, chunk_size);
+  if (!data) {
+    return NULL;
+  }
+  chunk->data = data;
+  chunk->index = aligned_size;
+  chunk->size = chunk_size;
+  chunk->generation = generation;
+  return (void*)data;
+}
+
+#if defined(TARGET_LINUX) || defined(TARGET_APPLE) || defined(TARGET_WINDOWS)
+
+static THREAD_LOCAL Arena arena_scratch[ARENA_SCRATCH_COUNT] = {0};
+static THREAD_LOCAL bool arena_scratch_registered = false;
+static Ticket arena_scratch_mutex = {0};
+static bool arena_scratch_initialized = false;
+
+static void arena_scratch_init(void);
+static void arena_scratch_destroy(void* data);
+
+#if defined(TARGET_LINUX) || defined(TARGET_APPLE)
+
+static pthread_key_t arena_scratch_key;
+
+// the key is only used for its destructor, so that the scratch arenas of threads made with thread_create_v2 are freed when they exit
+void arena_scratch_init(void) {
+  ticket_mutex_begin(&arena_scratch_mutex);
+  if (!arena_scratch_initialized) {
+    pthread_key_create(&arena_scratch_key, arena_scratch_destroy);
+    arena_scratch_initialized = true;
+  }
+  ticket_mutex_end(&arena_scratch_mutex);
+  pthread_setspecific(arena_scratch_key, arena_scratch);
+}
+
+#elif defined(TARGET_WINDOWS)
+
+static DWORD arena_scratch_key = 0;
+static VOID WINAPI arena_scratch_fls_callback(PVOID data);
+
+VOID WINAPI arena_scratch_fls_callback(PVOID data) {
+  arena_scratch_destroy(data);
+}
+
+void arena_scratch_init(void) {
+  ticket_mutex_begin(&arena_scratch_mutex);
+  if (!arena_scratch_initialized) {
+    arena_scratch_key = FlsAlloc(arena_scratch_fls_callback);
+    arena_scratch_initialized = true;
+  }
+  ticket_mutex_end(&arena_scratch_mutex);
+  FlsSetValue(arena_scratch_key, arena_scratch);
+}
+
+#endif
+
+void arena_scratch_destroy(void* data) {
+  Arena* scratch = (Arena*)data;
+  for (size_t i = 0; i < ARENA_SCRATCH_COUNT; ++i) {
+    if (scratch[i].data) {
+      arena_free(&scratch[i]);
+    }
+  }
+}
+
+// borrow a scratch arena of the calling thread that is not the conflict arena.
+// pass the arena that the caller allocates its results in as the conflict, in case that is a scratch arena itself
+COMMON_PUBLICDEF
+Arena_scratch arena_scratch_begin(Arena* conflict) {
+  Arena* arena = NULL;
+  for (size_t i = 0; i < ARENA_SCRATCH_COUNT; ++i) {
+    if (&arena_scratch[i] != conflict) {
+      arena = &arena_scratch[i];
+      break;
+    }
+  }
+  if (UNLIKELY(arena->data == NULL)) {
+    if (!arena_scratch_registered) {
+      arena_scratch_init();
+      arena_scratch_registered = true;
+    }
+    *arena = arena_new_chained(ARENA_SCRATCH_SIZE);
+  }
+  return (Arena_scratch) {
+    .arena = arena,
+    .mark = arena_mark(arena),
+  };
 }
+
+COMMON_PUBLICDEF
+void arena_scratch_end(Arena_scratch scratch) {
+  arena_restore(scratch.arena, scratch.mark);
+}
+
+// free the scratch arenas of the calling thread, this happens automatically when a thread made with thread_create_v2 exits
+COMMON_PUBLICDEF
+void arena_scratch_free(void) {
+  arena_scratch_destroy(arena_scratch);
+}
+
 #endif
+
+#endif // _THREAD_H
+
+#endif // ARENA_IMPLEMENTATION
+#undef ARENA_IMPLEMENTATION
@@ -0,0 +1,326 @@
+// bench_arena.c
+// throughput and latency of arena_alloc/arena_reset compared to malloc/free, the slab allocator, pools and the list macros,
+// and the resident memory of the slab allocator compared to malloc
+
+#include "bench_common.h"
+
+#define COMMON_IMPLEMENTATION
+#include "common.h"
+
+#define THREAD_IMPLEMENTATION
+#include "thread.h"
+
+#define RANDOM_IMPLEMENTATION
+#include "random.h"
+
+#define ARENA_IMPLEMENTATION
+#include "arena.h"
+
+#define POOL_IMPLEMENTATION
+#include "pool.h"
+
+#define SLAB_IMPLEMENTATION
+#include "slab.h"
+
+#if defined(TARGET_LINUX)
+  #include <sys/wait.h> // waitpid
+#endif
+
+// used by list_push and list_free
+#define memory_realloc realloc
+#define memory_free free
+
+#define SIZE_COUNT 4096
+#define ROUND_COUNT 200
+#define ROUND_SIZE 1024  // allocations before everything is released again
+#define BATCH_SIZE 16    // allocations per latency sample
+#define SAMPLE_COUNT (ROUND_COUNT * (ROUND_SIZE / BATCH_SIZE))
+#define APPEND_COUNT (1 << 20)
+#define FRAGMENT_COUNT (1 << 14) // live allocations in the fragmentation workload
+
+typedef enum Allocator {
+  ALLOCATOR_MALLOC,
+  ALLOCATOR_ARENA,
+  ALLOCATOR_SLAB,
+  ALLOCATOR_POOL,
+
+  MAX_ALLOCATOR,
+} Allocator;
+
+const char* allocator_str[MAX_ALLOCATOR] = {
+  "malloc",
+  "arena",
+  "slab",
+  "pool",
+};
+
+typedef struct Distribution {
+  const char* name;
+  size_t min;
+  size_t max;
+  u32 skew; // sizes are drawn as min + (max - min) * r^skew, r in [0, 1)
+} Distribution;
+
+const Distribution distributions[] = {
+  { "fixed", 32,   32,    1 },
+  { "small", 8,    64,    1 },
+  { "mixed", 8,    4096,  4 },
+  { "large", 1024, 16384, 1 },
+  { "huge",  8192, 65536, 2 }, // partly above SLAB_MAX_SIZE
+};
+
+typedef struct Handle {
+  const size_t* sizes;
+  Allocator allocator;
+  size_t slot_size; // for pools
+  u64 samples[SAMPLE_COUNT];
+  u8* items[ROUND_SIZE];
+  size_t index; // set before the thread starts, unlike id
+  i32 id;
+} Handle;
+
+void generate_sizes(size_t* sizes, const Distribution* distribution);
+void* work(Handle* handle);
+void bench_alloc(const size_t* sizes, const Distribution* distribution, Handle* handles);
+void bench_append(void);
+size_t resident_bytes(void);
+void fragment(const size_t* sizes, Allocator allocator, size_t* live_bytes, size_t* rss);
+void bench_fragmentation(size_t* sizes);
+
+i32 main(void) {
+  thread_init();
+  random_init(1234);
+  size_t* sizes = (size_t*)malloc(SIZE_COUNT * sizeof(size_t));
+  // first, before the other benchmarks leave freed memory in the heap that would be reused without counting
+  bench_fragmentation(sizes);
+  Handle* handles = (Handle*)calloc(NPROC, sizeof(Handle));
+  stb_printf("%-6s %-7s %7s %12s %8s %8s %8s %8s\n", "sizes", "alloc", "threads", "Mops/s", "p50 ns", "p99 ns", "p99.9 ns", "max ns");
+  for (size_t i = 0; i < LENGTH(distributions); ++i) {
+    generate_sizes(sizes, &distributions[i]);
+    bench_alloc(sizes, &distributions[i], handles);
+  }
+  bench_append();
+  free(handles);
+  free(sizes);
+  return EXIT_SUCCESS;
+}
+
+void generate_sizes(size_t* sizes, const Distribution* distribution) {
+  for (size_t i = 0; i < SIZE_COUNT; ++i) {
+    f64 r = (random_number() % 1000000) / 1000000.0;
+    f64 t = r;
+    for (u32 k = 1; k < distribution->skew; ++k) {
+      t *= r;
+    }
+    sizes[i] = distribution->min + (size_t)((distribution->max - distribution->min) * t);
+  }
+}
+
+void bench_alloc(const size_t* sizes, const Distribution* distribution, Handle* handles) {
+  for (Allocator allocator = 0; allocator < MAX_ALLOCATOR; ++allocator) {
+    continue_if(allocator == ALLOCATOR_POOL && distribution->min != distribution->max);
+    for (size_t thread_count = 1;; thread_count = MIN(thread_count * 2, NPROC)) {
+      u64 start = bench_now();
+      for (size_t i = 0; i < thread_count; ++i) {
+        Handle* handle = &handles[i];
+        handle->sizes = sizes;
+        handle->allocator = allocator;
+        handle->slot_size = distribution->max;
+        handle->index = i;
+        if ((handle->id = thread_create_v2((void*)work, handle)) < 0) {
+          return;
+        }
+      }
+      for (size_t i = 0; i < thread_count; ++i) {
+        thread_join(handles[i].id);
+      }
+      u64 elapsed = bench_now() - start;
+      // latency of the first thread is representative, all threads do the same work
+      Latency latency = bench_latency(handles[0].samples, SAMPLE_COUNT);
+      f64 ops = (f64)thread_count * ROUND_COUNT * ROUND_SIZE;
+      stb_printf("%-6s %-7s %7zu %12.2f %8llu %8llu %8llu %8llu\n",
+        distribution->name,
+        allocator_str[allocator],
+        thread_count,
+        ops / (elapsed / 1000.0),
+        (unsigned long long)latency.p50,
+        (unsigned long long)latency.p99,
+        (unsigned long long)latency.p999,
+        (unsigned long long)latency.max
+      );
+      break_if(thread_count == NPROC);
+    }
+  }
+}
+
+void* work(Handle* handle) {
+  Arena arena = arena_new_chained(Kb(64));
+  Pool pool = pool_new(&arena, handle->slot_size, ARENA_DEFAULT_ALIGNMENT);
+  size_t size_index = handle->index * 97;
+  size_t sample_index = 0;
+  for (size_t round = 0; round < ROUND_COUNT; ++round) {
+    for (size_t i = 0; i < ROUND_SIZE; i += BATCH_SIZE) {
+      u64 start = bench_now();
+      for (size_t j = i; j < i + BATCH_SIZE; ++j) {
+        size_t size = handle->sizes[size_index++ % SIZE_COUNT];
+        u8* p = NULL;
+        switch (handle->allocator) {
+          case ALLOCATOR_MALLOC: p = (u8*)malloc(size); break;
+          case ALLOCATOR_ARENA:  p = (u8*)arena_alloc_aligned(&arena, size, ARENA_DEFAULT_ALIGNMENT); break;
+          case ALLOCATOR_SLAB:   p = (u8*)slab_malloc(size); break;
+          case ALLOCATOR_POOL:   p = (u8*)pool_alloc(&pool); break;
+          default: break;
+        }
+        *p = (u8)j;
+        handle->items[j] = p;
+      }
+      handle->samples[sample_index++] = (bench_now() - start) / BATCH_SIZE;
+    }
+    switch (handle->allocator) {
+      case ALLOCATOR_MALLOC: {
+        for (size_t i = 0; i < ROUND_SIZE; ++i) {
+          free(handle->items[i]);
+        }
+        break;
+      }
+      case ALLOCATOR_ARENA: {
+        arena_reset(&arena);
+        break;
+      }
+      case ALLOCATOR_SLAB: {
+        for (size_t i = 0; i < ROUND_SIZE; ++i) {
+          slab_free(handle->items[i]);
+        }
+        break;
+      }
+      case ALLOCATOR_POOL: {
+        for (size_t i = 0; i < ROUND_SIZE; ++i) {
+          pool_free(&pool, handle->items[i]);
+        }
+        break;
+      }
+      default:
+        break;
+    }
+  }
+  arena_free(&arena);
+  return NULL;
+}
+
+typedef struct List {
+  i32* items;
+  size_t count;
+  size_t size;
+} List;
+
+// growing an array one item at a time, with the list macros and with arena_resize
+void bench_append(void) {
+  List list = {0};
+  u64 start = bench_now();
+  for (i32 i = 0; i < APPEND_COUNT; ++i) {
+    list_push(&list, i);
+  }
+  u64 list_time = bench_now() - start;
+  list_free(&list);
+
+  Arena arena = arena_new_virtual(Gb(1ull), 0);
+  i32* items = NULL;
+  size_t count = 0;
+  start = bench_now();
+  for (i32 i = 0; i < APPEND_COUNT; ++i) {
+    items = (i32*)arena_resize(&arena, items, count * sizeof(i32), (count + 1) * sizeof(i32));
+    items[count++] = i;
+  }
+  u64 arena_time = bench_now() - start;
+  arena_free(&arena);
+
+  stb_printf("\nappend %d items:\n", APPEND_COUNT);
+  stb_printf("  list_push:    %8.2f ns/item\n", (f64)list_time / APPEND_COUNT);
+  stb_printf("  arena_resize: %8.2f ns/item\n", (f64)arena_time / APPEND_COUNT);
+}
+
+// resident set size of the process, 0 where it can not be read
+size_t resident_bytes(void) {
+  size_t rss = 0;
+#if defined(TARGET_LINUX)
+  FILE* file = fopen("/proc/self/statm", "r");
+  if (file) {
+    unsigned long size = 0;
+    unsigned long pages = 0;
+    if (fscanf(file, "%lu %lu", &size, &pages) == 2) {
+      rss = (size_t)pages * (size_t)sysconf(_SC_PAGESIZE);
+    }
+    fclose(file);
+  }
+#endif
+  return rss;
+}
+
+// allocate, free a random half and allocate again with other sizes, so that the holes left behind have to be reused
+void fragment(const size_t* sizes, Allocator allocator, size_t* live_bytes, size_t* rss) {
+  u8** items = (u8**)calloc(FRAGMENT_COUNT, sizeof(u8*));
+  size_t* item_sizes = (size_t*)calloc(FRAGMENT_COUNT, sizeof(size_t));
+  // the bookkeeping is resident before measuring
+  memset(items, 0, FRAGMENT_COUNT * sizeof(u8*));
+  memset(item_sizes, 0, FRAGMENT_COUNT * sizeof(size_t));
+  const size_t before = resident_bytes();
+  *live_bytes = 0;
+  for (size_t round = 0; round < 3; ++round) {
+    for (size_t i = 0; i < FRAGMENT_COUNT; ++i) {
+      continue_if(items[i]);
+      item_sizes[i] = sizes[(i * 7 + round * 131) % SIZE_COUNT];
+      items[i] = (u8*)(allocator == ALLOCATOR_SLAB ? slab_malloc(item_sizes[i]) : malloc(item_sizes[i]));
+      memset(items[i], (u8)i, item_sizes[i]);
+      *live_bytes += item_sizes[i];
+    }
+    break_if(round == 2);
+    for (size_t i = 0; i < FRAGMENT_COUNT; ++i) {
+      continue_if(random_number() & 1);
+      allocator == ALLOCATOR_SLAB ? slab_free(items[i]) : free(items[i]);
+      items[i] = NULL;
+      *live_bytes -= item_sizes[i];
+    }
+  }
+  *rss = resident_bytes() - before;
+  for (size_t i = 0; i < FRAGMENT_COUNT; ++i) {
+    allocator == ALLOCATOR_SLAB ? slab_free(items[i]) : free(items[i]);
+  }
+  free(item_sizes);
+  free(items);
+}
+
+// every run gets a fresh process, memory that one allocator keeps around after freeing would count against the next
+void bench_fragmentation(size_t* sizes) {
+#if defined(TARGET_LINUX)
+  stb_printf("resident memory after %d mixed allocations and frees:\n", FRAGMENT_COUNT);
+  stb_printf("%-6s %-7s %12s %12s %10s\n", "sizes", "alloc", "live MB", "rss MB", "rss/live");
+  for (size_t i = 0; i < LENGTH(distributions); ++i) {
+    generate_sizes(sizes, &distributions[i]);
+    const Allocator allocators[] = { ALLOCATOR_MALLOC, ALLOCATOR_SLAB, };
+    for (size_t j = 0; j < LENGTH(allocators); ++j) {
+      fflush(stdout);
+      pid_t pid = fork();
+      if (pid == 0) {
+        size_t live_bytes = 0;
+        size_t rss = 0;
+        fragment(sizes, allocators[j], &live_bytes, &rss);
+        stb_printf("%-6s %-7s %12.2f %12.2f %10.2f\n",
+          distributions[i].name,
+          allocator_str[allocators[j]],
+          live_bytes / (f64)Mb(1),
+          rss / (f64)Mb(1),
+          (f64)rss / live_bytes
+        );
+        fflush(stdout);
+        _exit(EXIT_SUCCESS);
+      }
+      if (pid > 0) {
+        waitpid(pid, NULL, 0);
+      }
+    }
+  }
+  stb_printf("\n");
+#else
+  (void)sizes;
+#endif
+}
@@ -0,0 +1,128 @@
+// bench_buffer.c
+// loading a directory of many small files one at a time compared to buffer_new_from_files
+
+#include "bench_common.h"
+
+#define COMMON_IMPLEMENTATION
+#include "common.h"
+
+#define THREAD_IMPLEMENTATION
+#include "thread.h"
+
+#define BUFFER_IMPL
+#include "buffer.h"
+
+#define FILES_PATH "bench_buffer_files"
+#define FILE_COUNT 4000
+#define MIN_FILE_SIZE 256
+#define MAX_FILE_SIZE 8192
+#define ROUND_COUNT 5
+
+typedef enum Method {
+  METHOD_SEQUENTIAL,
+  METHOD_IO_URING,
+  METHOD_THREADS,
+
+  MAX_METHOD,
+} Method;
+
+const char* method_str[MAX_METHOD] = {
+  "buffer_new_from_file",
+  "buffer_new_from_files (io_uring)",
+  "buffer_new_from_files (threads)",
+};
+
+char paths[FILE_COUNT][64] = {0};
+const char* path_list[FILE_COUNT] = {0};
+
+Result generate_files(void);
+void remove_files(void);
+u64 load(Method method, size_t* bytes);
+
+i32 main(void) {
+  thread_init();
+  if (generate_files() != Ok) {
+    stb_printf("failed to generate files in %s\n", FILES_PATH);
+    remove_files();
+    return EXIT_FAILURE;
+  }
+  stb_printf("%-34s %10s %12s %10s\n", "load", "ms", "files/s", "MB/s");
+  for (Method method = 0; method < MAX_METHOD; ++method) {
+    u64 samples[ROUND_COUNT] = {0};
+    size_t bytes = 0;
+    for (size_t round = 0; round < ROUND_COUNT; ++round) {
+      samples[round] = load(method, &bytes);
+    }
+    Latency latency = bench_latency(samples, ROUND_COUNT);
+    f64 seconds = latency.p50 / 1000000000.0;
+    stb_printf("%-34s %10.2f %12.0f %10.1f\n",
+      method_str[method],
+      latency.p50 / 1000000.0,
+      FILE_COUNT / seconds,
+      (bytes / (1024.0 * 1024.0)) / seconds
+    );
+  }
+  remove_files();
+  return EXIT_SUCCESS;
+}
+
+Result generate_files(void) {
+  char data[MAX_FILE_SIZE] = {0};
+  mkdir(FILES_PATH, 0755);
+  u32 state = 1234;
+  for (size_t i = 0; i < FILE_COUNT; ++i) {
+    stb_snprintf(paths[i], sizeof(paths[i]), FILES_PATH "/%zu.txt", i);
+    path_list[i] = paths[i];
+    state = state * 1664525u + 1013904223u;
+    size_t size = MIN_FILE_SIZE + (state >> 8) % (MAX_FILE_SIZE - MIN_FILE_SIZE);
+    memset(data, 'a' + i % 26, size);
+    i32 fd = open(paths[i], O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+      return Error;
+    }
+    ssize_t written = write(fd, data, size);
+    close(fd);
+    if (written != (ssize_t)size) {
+      return Error;
+    }
+  }
+  return Ok;
+}
+
+void remove_files(void) {
+  for (size_t i = 0; i < FILE_COUNT; ++i) {
+    continue_if(!paths[i][0]);
+    remove(paths[i]);
+  }
+  rmdir(FILES_PATH);
+}
+
+// time to load every file, in nanoseconds
+u64 load(Method method, size_t* bytes) {
+  Buffer* buffers = NULL;
+  u64 start = bench_now();
+  switch (method) {
+    case METHOD_SEQUENTIAL: {
+      buffers = (Buffer*)calloc(FILE_COUNT, sizeof(Buffer));
+      for (size_t i = 0; i < FILE_COUNT; ++i) {
+        buffers[i] = buffer_new_from_file(path_list[i]);
+      }
+      break;
+    }
+    case METHOD_IO_URING:
+    case METHOD_THREADS: {
+      buffer_files_io_uring = method == METHOD_IO_URING;
+      buffers = buffer_new_from_files(path_list, FILE_COUNT);
+      break;
+    }
+    default:
+      break;
+  }
+  u64 elapsed = bench_now() - start;
+  *bytes = 0;
+  for (size_t i = 0; i < FILE_COUNT; ++i) {
+    *bytes += buffers[i].count;
+  }
+  buffer_free_files(buffers, FILE_COUNT);
+  return elapsed;
+}
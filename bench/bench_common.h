@@ -0,0 +1,58 @@
+// bench_common.h
+
+#ifndef _BENCH_COMMON_H
+#define _BENCH_COMMON_H
+
+#define STB_SPRINTF_IMPLEMENTATION
+#define USE_STB_SPRINTF
+#include "stb_sprintf.h"
+
+#include "common.h"
+
+typedef struct Latency {
+  u64 p50;
+  u64 p99;
+  u64 p999;
+  u64 max;
+} Latency;
+
+static u64 bench_now(void);
+static i32 bench_compare_u64(const void* a, const void* b);
+static Latency bench_latency(u64* samples, size_t count);
+
+// monotonic time in nanoseconds
+u64 bench_now(void) {
+#ifdef TARGET_WINDOWS
+  LARGE_INTEGER frequency;
+  LARGE_INTEGER counter;
+  QueryPerformanceFrequency(&frequency);
+  QueryPerformanceCounter(&counter);
+  return (u64)((counter.QuadPart * 1000000000.0) / frequency.QuadPart);
+#else
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (u64)ts.tv_sec * 1000000000ull + (u64)ts.tv_nsec;
+#endif
+}
+
+i32 bench_compare_u64(const void* a, const void* b) {
+  u64 x = *(const u64*)a;
+  u64 y = *(const u64*)b;
+  return (x > y) - (x < y);
+}
+
+// sorts the samples in place
+Latency bench_latency(u64* samples, size_t count) {
+  Latency latency = {0};
+  if (count == 0) {
+    return latency;
+  }
+  qsort(samples, count, sizeof(u64), bench_compare_u64);
+  latency.p50 = samples[(count * 50) / 100];
+  latency.p99 = samples[(count * 99) / 100];
+  latency.p999 = samples[(count * 999) / 1000];
+  latency.max = samples[count - 1];
+  return latency;
+}
+
+#endif // _BENCH_COMMON_H
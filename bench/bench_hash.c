@@ -0,0 +1,60 @@
+// bench_hash.c
+// byte-at-a-time djb2 (as used in wav.h) compared to hash64, for short keys and long inputs
+
+#include "bench_common.h"
+
+#define COMMON_IMPLEMENTATION
+#include "common.h"
+
+#define HASH_IMPLEMENTATION
+#include "hash.h"
+
+#define DATA_SIZE Mb(16)
+#define TOTAL_BYTES Mb(32)
+#define SAMPLE_COUNT 9
+
+u64 djb2(const void* data, size_t count);
+f64 run(u64 (*func)(const void*, size_t), const u8* data, size_t count, u64* sink);
+
+u64 djb2(const void* data, size_t count) {
+  const u8* p = (const u8*)data;
+  u64 h = 5381;
+  for (size_t i = 0; i < count; ++i) {
+    h = ((h << 5) + h) + p[i];
+  }
+  return h;
+}
+
+// median throughput in GB/s
+f64 run(u64 (*func)(const void*, size_t), const u8* data, size_t count, u64* sink) {
+  const size_t rounds = MAX(TOTAL_BYTES / count, (size_t)1);
+  const size_t slots = DATA_SIZE / count;
+  u64 samples[SAMPLE_COUNT] = {0};
+  for (size_t sample = 0; sample < SAMPLE_COUNT; ++sample) {
+    u64 start = bench_now();
+    for (size_t i = 0; i < rounds; ++i) {
+      *sink += func(&data[(i % slots) * count], count);
+    }
+    samples[sample] = bench_now() - start;
+  }
+  Latency latency = bench_latency(samples, SAMPLE_COUNT);
+  return (f64)(rounds * count) / latency.p50;
+}
+
+i32 main(void) {
+  u8* data = (u8*)malloc(DATA_SIZE);
+  for (size_t i = 0; i < DATA_SIZE; ++i) {
+    data[i] = (u8)(i * 2654435761u >> 13);
+  }
+  const size_t sizes[] = { 8, 16, 64, 256, Kb(4), Kb(64), Mb(16), };
+  u64 sink = 0;
+  printf("%10s %14s %14s\n", "bytes", "djb2 GB/s", "hash64 GB/s");
+  for (size_t i = 0; i < LENGTH(sizes); ++i) {
+    f64 djb2_speed = run(djb2, data, sizes[i], &sink);
+    f64 hash_speed = run(hash64, data, sizes[i], &sink);
+    printf("%10zu %14.2f %14.2f\n", sizes[i], djb2_speed, hash_speed);
+  }
+  printf("(%llx)\n", (unsigned long long)sink);
+  free(data);
+  return 0;
+}
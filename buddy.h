@@ -0,0 +1,203 @@
+// buddy.h
+// power-of-two buddy allocator on top of an arena
+
+// macros:
+//  BUDDY_IMPLEMENTATION
+//  BUDDY_MIN_BLOCK_SIZE = 64
+
+#ifndef _BUDDY_H
+#define _BUDDY_H
+
+#include "arena.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// smallest block that is handed out, must be a power of two that fits a Buddy_block
+#ifndef BUDDY_MIN_BLOCK_SIZE
+  #define BUDDY_MIN_BLOCK_SIZE 64
+#endif
+
+#define BUDDY_ORDER_COUNT 64
+#define BUDDY_FREE 0x80 // set in the order of a block that is on a free list
+
+// free blocks are linked through their own memory
+typedef struct Buddy_block {
+  struct Buddy_block* next;
+  struct Buddy_block* prev;
+} Buddy_block;
+
+typedef struct Buddy {
+  Arena arena;     // owns the region and the block orders
+  u8* base;
+  size_t size;     // size of the region, a power of two
+  u32 min_order;
+  u32 max_order;
+  u8* orders;      // order of the block that starts at every min block, BUDDY_FREE if it is free
+  Buddy_block* free[BUDDY_ORDER_COUNT];
+  size_t used;     // bytes in allocated blocks
+} Buddy;
+
+typedef struct Buddy_stats {
+  size_t used;
+  size_t free;
+  size_t largest_free;  // largest allocation that can succeed right now
+  size_t free_blocks;
+  f32 fragmentation;    // 0 when all free memory is one block, towards 1 the more it is split up
+} Buddy_stats;
+
+COMMON_PUBLICDEC Buddy buddy_new(const size_t size);
+COMMON_PUBLICDEC void* buddy_alloc(Buddy* buddy, const size_t size);
+COMMON_PUBLICDEC void buddy_free(Buddy* buddy, void* p);
+COMMON_PUBLICDEC size_t buddy_block_size(Buddy* buddy, void* p);
+COMMON_PUBLICDEC Buddy_stats buddy_stats(Buddy* buddy);
+COMMON_PUBLICDEC void buddy_destroy(Buddy* buddy);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _BUDDY_H
+
+#ifdef BUDDY_IMPLEMENTATION
+
+static u32 buddy_order_of(size_t size);
+static void buddy_push(Buddy* buddy, Buddy_block* block, u32 order);
+static void buddy_remove(Buddy* buddy, Buddy_block* block, u32 order);
+static size_t buddy_index(Buddy* buddy, void* p);
+
+// smallest order whose block fits size
+u32 buddy_order_of(size_t size) {
+  u32 order = 0;
+  while (((size_t)1 << order) < size) {
+    order += 1;
+  }
+  return order;
+}
+
+size_t buddy_index(Buddy* buddy, void* p) {
+  return ((u8*)p - buddy->base) >> buddy->min_order;
+}
+
+void buddy_push(Buddy* buddy, Buddy_block* block, u32 order) {
+  block->prev = NULL;
+  block->next = buddy->free[order];
+  if (block->next) {
+    block->next->prev = block;
+  }
+  buddy->free[order] = block;
+  buddy->orders[buddy_index(buddy, block)] = BUDDY_FREE | order;
+}
+
+void buddy_remove(Buddy* buddy, Buddy_block* block, u32 order) {
+  if (block->prev) {
+    block->prev->next = block->next;
+  }
+  else {
+    buddy->free[order] = block->next;
+  }
+  if (block->next) {
+    block->next->prev = block->prev;
+  }
+  buddy->orders[buddy_index(buddy, block)] = order;
+}
+
+// size is rounded up to a power of two
+COMMON_PUBLICDEF
+Buddy buddy_new(const size_t size) {
+  ASSERT(BUDDY_MIN_BLOCK_SIZE >= sizeof(Buddy_block));
+  ASSERT((BUDDY_MIN_BLOCK_SIZE & (BUDDY_MIN_BLOCK_SIZE - 1)) == 0);
+  Buddy buddy = {0};
+  buddy.min_order = buddy_order_of(BUDDY_MIN_BLOCK_SIZE);
+  buddy.max_order = MAX(buddy_order_of(size), buddy.min_order);
+  ASSERT(buddy.max_order < BUDDY_ORDER_COUNT);
+  buddy.size = (size_t)1 << buddy.max_order;
+  size_t block_count = buddy.size >> buddy.min_order;
+  buddy.arena = arena_new(block_count + buddy.size + BUDDY_MIN_BLOCK_SIZE);
+  buddy.orders = (u8*)arena_alloc(&buddy.arena, block_count);
+  buddy.base = (u8*)arena_alloc_aligned(&buddy.arena, buddy.size, BUDDY_MIN_BLOCK_SIZE);
+  ASSERT(buddy.orders != NULL && buddy.base != NULL);
+  memset(buddy.orders, 0, block_count);
+  buddy_push(&buddy, (Buddy_block*)buddy.base, buddy.max_order);
+  return buddy;
+}
+
+COMMON_PUBLICDEF
+void* buddy_alloc(Buddy* buddy, const size_t size) {
+  ASSERT(buddy != NULL);
+  u32 order = MAX(buddy_order_of(size), buddy->min_order);
+  if (order > buddy->max_order) {
+    return NULL;
+  }
+  u32 k = order;
+  while (k <= buddy->max_order && !buddy->free[k]) {
+    k += 1;
+  }
+  if (k > buddy->max_order) {
+    return NULL;
+  }
+  Buddy_block* block = buddy->free[k];
+  buddy_remove(buddy, block, k);
+  // split until the block has the requested order, the upper halves go on the free lists
+  while (k > order) {
+    k -= 1;
+    buddy_push(buddy, (Buddy_block*)((u8*)block + ((size_t)1 << k)), k);
+  }
+  buddy->orders[buddy_index(buddy, block)] = order;
+  buddy->used += (size_t)1 << order;
+  return (void*)block;
+}
+
+COMMON_PUBLICDEF
+void buddy_free(Buddy* buddy, void* p) {
+  ASSERT(buddy != NULL);
+  if (!p) {
+    return;
+  }
+  ASSERT((u8*)p >= buddy->base && (u8*)p < buddy->base + buddy->size);
+  u32 order = buddy->orders[buddy_index(buddy, p)];
+  ASSERT(!(order & BUDDY_FREE) && "double free");
+  buddy->used -= (size_t)1 << order;
+  size_t offset = (u8*)p - buddy->base;
+  // merge with the buddy for as long as it is free and of the same order
+  while (order < buddy->max_order) {
+    size_t buddy_offset = offset ^ ((size_t)1 << order);
+    u8* other = buddy->base + buddy_offset;
+    break_if(buddy->orders[buddy_index(buddy, other)] != (BUDDY_FREE | order));
+    buddy_remove(buddy, (Buddy_block*)other, order);
+    offset = MIN(offset, buddy_offset);
+    order += 1;
+  }
+  buddy_push(buddy, (Buddy_block*)(buddy->base + offset), order);
+}
+
+COMMON_PUBLICDEF
+size_t buddy_block_size(Buddy* buddy, void* p) {
+  return (size_t)1 << (buddy->orders[buddy_index(buddy, p)] & ~BUDDY_FREE);
+}
+
+COMMON_PUBLICDEF
+Buddy_stats buddy_stats(Buddy* buddy) {
+  Buddy_stats stats = {0};
+  stats.used = buddy->used;
+  for (u32 order = buddy->min_order; order <= buddy->max_order; ++order) {
+    for (Buddy_block* block = buddy->free[order]; block; block = block->next) {
+      stats.free += (size_t)1 << order;
+      stats.largest_free = (size_t)1 << order;
+      stats.free_blocks += 1;
+    }
+  }
+  stats.fragmentation = stats.free ? 1.0f - (f32)stats.largest_free / stats.free : 0.0f;
+  return stats;
+}
+
+COMMON_PUBLICDEF
+void buddy_destroy(Buddy* buddy) {
+  ASSERT(buddy != NULL);
+  arena_free(&buddy->arena);
+  memset(buddy, 0, sizeof(*buddy));
+}
+
+#endif // BUDDY_IMPLEMENTATION
+#undef BUDDY_IMPLEMENTATION
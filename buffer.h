@@ -5,6 +5,8 @@
 
 #include <stddef.h> // size_t
 #include <fcntl.h> // open
+#include <assert.h>
+#include <errno.h> // EINTR
 
 #ifdef __cplusplus
   #define RESTRICT
@@ -20,6 +22,35 @@
   #define BUFFER_INIT_SIZE 16
 #endif
 
+// size of the window that a Buffer_reader refills from its fd
+#ifndef BUFFER_READER_SIZE
+  #define BUFFER_READER_SIZE (64 * 1024)
+#endif
+
+// default number of bytes a Buffer_writer collects before it writes them out
+#ifndef BUFFER_WRITER_SIZE
+  #define BUFFER_WRITER_SIZE (64 * 1024)
+#endif
+
+// files that are loaded together by buffer_new_from_files
+#ifndef BUFFER_FILE_BATCH_SIZE
+  #define BUFFER_FILE_BATCH_SIZE 64
+#endif
+
+// first read of files that report no size in buffer_new_from_files, such as the ones in /proc. doubles until the
+// whole file fits
+#ifndef BUFFER_FILE_READ_SIZE
+  #define BUFFER_FILE_READ_SIZE (16 * 1024)
+#endif
+
+// returned by the search functions when there is no match
+#define BUFFER_NOT_FOUND ((size_t)-1)
+
+// how much the buffer grows by when it runs out of space
+#ifndef BUFFER_GROWTH_FACTOR
+  #define BUFFER_GROWTH_FACTOR 2
+#endif
+
 #ifndef BUFFER_MEMORY_MALLOC
   #define BUFFER_MEMORY_MALLOC malloc
 #endif
@@ -42,28 +73,660 @@ void* (*buffer_memory_calloc)(size_t n, size_t size) = BUFFER_MEMORY_CALLOC;
 void* (*buffer_memory_realloc)(void* p, size_t size) = BUFFER_MEMORY_REALLOC;
 void  (*buffer_memory_free)(void* p)                 = BUFFER_MEMORY_FREE;
 
+// buffer_new_from_files tries io_uring first when this is set, define BUFFER_NO_IO_URING to leave it out entirely
+bool buffer_files_io_uring = true;
+
+// access pattern hint for mapped buffers
+typedef enum Buffer_advice {
+  BUFFER_ADVICE_NORMAL,
+  BUFFER_ADVICE_SEQUENTIAL, // read front to back, pages behind the reader can be dropped early
+  BUFFER_ADVICE_WILLNEED,   // start reading the whole file in ahead of time
+} Buffer_advice;
+
 typedef struct Buffer {
   char* data;
   size_t count; // how many bytes are in use?
   size_t size;  // number of bytes allocated
 } Buffer;
 
+// reads from any fd, including pipes and sockets, through a fixed-size window
+typedef struct Buffer_reader {
+  int fd;
+  Buffer window;  // count is the number of bytes that have been read into the window
+  size_t index;   // first byte that has not been consumed yet
+  bool eof;
+  int error;      // errno of the read that failed, 0 otherwise
+} Buffer_reader;
+
+typedef enum Buffer_writer_flag {
+  BUFFER_WRITER_LINE = 1 << 0, // flush whenever a newline is written
+} Buffer_writer_flag;
+
+// collects output for an fd and writes it out in as few syscalls as possible
+typedef struct Buffer_writer {
+  int fd;
+  Buffer buffer;
+  size_t threshold; // flush once this many bytes are buffered
+  int flags;
+  int error;        // errno of the write that failed, 0 otherwise
+} Buffer_writer;
+
+// borrowed bytes, from a Buffer, a mapped file or a literal, that stay valid only as long as what they point into
+typedef struct String_view {
+  const char* data;
+  size_t count;
+} String_view;
+
+// stb_printf("" SV_FMT "\n", SV_ARG(view));
+#define SV_FMT "%.*s"
+#define SV_ARG(VIEW) (int)(VIEW).count, (VIEW).data
+
+// where every line of a buffer starts, so that lines can be looked up by number
+typedef struct Buffer_lines {
+  size_t* offsets; // offsets[count] is one past the end of the buffer, as if it ended in a newline
+  size_t count;    // number of lines, one more than the number of newlines
+} Buffer_lines;
+
+// text with a movable gap at the edit position, so that repeated edits at one place do not move the rest of the text
+typedef struct Gap_buffer {
+  char* data;
+  size_t size;      // number of bytes allocated
+  size_t gap_start; // text is data[0, gap_start) followed by data[gap_end, size)
+  size_t gap_end;
+} Gap_buffer;
+
 BUFFER_PUBLICDEC Buffer buffer_new(size_t size);
 BUFFER_PUBLICDEC Buffer buffer_new_from_str(const char* str);
 BUFFER_PUBLICDEC Buffer buffer_new_from_fmt(size_t size, const char* fmt, ...);
 BUFFER_PUBLICDEC void buffer_from_fmt(Buffer* buffer, size_t size, const char* fmt, ...);
 BUFFER_PUBLICDEC void buffer_reset(Buffer* buffer);
+BUFFER_PUBLICDEC void buffer_reserve(Buffer* buffer, size_t size);
 BUFFER_PUBLICDEC void buffer_append(Buffer* buffer, char byte);
+BUFFER_PUBLICDEC void buffer_append_n(Buffer* buffer, const char* data, size_t count);
+BUFFER_PUBLICDEC void buffer_append_str(Buffer* buffer, const char* str);
+BUFFER_PUBLICDEC size_t buffer_appendf(Buffer* buffer, const char* fmt, ...);
+BUFFER_PUBLICDEC size_t buffer_vappendf(Buffer* buffer, const char* fmt, va_list argp);
 BUFFER_PUBLICDEC void buffer_insert(Buffer* buffer, char byte, size_t index);
+BUFFER_PUBLICDEC void buffer_insert_n(Buffer* buffer, const char* data, size_t count, size_t index);
 BUFFER_PUBLICDEC void buffer_erase(Buffer* buffer, size_t index);
 BUFFER_PUBLICDEC void buffer_free(Buffer* buffer);
 BUFFER_PUBLICDEC Buffer buffer_new_from_fd(int fd);
 BUFFER_PUBLICDEC Buffer buffer_new_from_file(const char* path);
+BUFFER_PUBLICDEC Buffer buffer_new_from_fd_mapped(int fd, Buffer_advice advice);
+BUFFER_PUBLICDEC Buffer buffer_new_from_file_mapped(const char* path, Buffer_advice advice);
+BUFFER_PUBLICDEC void buffer_free_mapped(Buffer* buffer);
+BUFFER_PUBLICDEC Buffer* buffer_new_from_files(const char** paths, size_t count);
+BUFFER_PUBLICDEC void buffer_free_files(Buffer* buffers, size_t count);
+BUFFER_PUBLICDEC Buffer_reader buffer_reader_new(int fd, size_t size);
+BUFFER_PUBLICDEC size_t buffer_reader_fill(Buffer_reader* reader, size_t count);
+BUFFER_PUBLICDEC size_t buffer_reader_peek(Buffer_reader* reader, const char** data, size_t count);
+BUFFER_PUBLICDEC void buffer_reader_consume(Buffer_reader* reader, size_t count);
+BUFFER_PUBLICDEC size_t buffer_reader_read(Buffer_reader* reader, char* data, size_t count);
+BUFFER_PUBLICDEC size_t buffer_reader_read_until(Buffer_reader* reader, char delimiter, Buffer* out);
+BUFFER_PUBLICDEC void buffer_reader_free(Buffer_reader* reader);
+BUFFER_PUBLICDEC size_t buffer_find_byte(const Buffer* buffer, size_t start, char byte);
+BUFFER_PUBLICDEC size_t buffer_find_any(const Buffer* buffer, size_t start, const char* set, size_t set_count);
+BUFFER_PUBLICDEC size_t buffer_count_byte(const Buffer* buffer, char byte);
+BUFFER_PUBLICDEC Buffer_lines buffer_lines_new(const Buffer* buffer);
+BUFFER_PUBLICDEC const char* buffer_line(const Buffer* buffer, const Buffer_lines* lines, size_t line, size_t* length);
+BUFFER_PUBLICDEC void buffer_lines_free(Buffer_lines* lines);
+BUFFER_PUBLICDEC String_view string_view_new(const char* data, size_t count);
+BUFFER_PUBLICDEC String_view string_view_from_str(const char* str);
+BUFFER_PUBLICDEC String_view string_view_from_buffer(const Buffer* buffer);
+BUFFER_PUBLICDEC String_view string_view_slice(String_view view, size_t start, size_t count);
+BUFFER_PUBLICDEC String_view string_view_trim(String_view view);
+BUFFER_PUBLICDEC String_view string_view_trim_left(String_view view);
+BUFFER_PUBLICDEC String_view string_view_trim_right(String_view view);
+BUFFER_PUBLICDEC size_t string_view_find_byte(String_view view, char byte);
+BUFFER_PUBLICDEC size_t string_view_find(String_view view, String_view needle);
+BUFFER_PUBLICDEC bool string_view_equal(String_view a, String_view b);
+BUFFER_PUBLICDEC i32 string_view_compare(String_view a, String_view b);
+BUFFER_PUBLICDEC bool string_view_starts_with(String_view view, String_view prefix);
+BUFFER_PUBLICDEC String_view string_view_split(String_view* view, char delimiter);
+BUFFER_PUBLICDEC bool string_view_token(String_view* view, const char* delimiters, String_view* token);
+BUFFER_PUBLICDEC Buffer string_view_to_buffer(String_view view);
+BUFFER_PUBLICDEC Buffer_writer buffer_writer_new(int fd, size_t threshold, int flags);
+BUFFER_PUBLICDEC Result buffer_writer_write(Buffer_writer* writer, const char* data, size_t count);
+BUFFER_PUBLICDEC Result buffer_writer_write_str(Buffer_writer* writer, const char* str);
+BUFFER_PUBLICDEC Result buffer_writer_flush(Buffer_writer* writer);
+BUFFER_PUBLICDEC Result buffer_writer_free(Buffer_writer* writer);
+BUFFER_PUBLICDEC Gap_buffer gap_buffer_new(size_t size);
+BUFFER_PUBLICDEC size_t gap_buffer_count(const Gap_buffer* buffer);
+BUFFER_PUBLICDEC char gap_buffer_at(const Gap_buffer* buffer, size_t index);
+BUFFER_PUBLICDEC void gap_buffer_move(Gap_buffer* buffer, size_t index);
+BUFFER_PUBLICDEC void gap_buffer_append(Gap_buffer* buffer, char byte);
+BUFFER_PUBLICDEC void gap_buffer_append_n(Gap_buffer* buffer, const char* data, size_t count);
+BUFFER_PUBLICDEC void gap_buffer_insert(Gap_buffer* buffer, char byte, size_t index);
+BUFFER_PUBLICDEC void gap_buffer_insert_n(Gap_buffer* buffer, const char* data, size_t count, size_t index);
+BUFFER_PUBLICDEC void gap_buffer_erase(Gap_buffer* buffer, size_t index);
+BUFFER_PUBLICDEC void gap_buffer_erase_n(Gap_buffer* buffer, size_t index, size_t count);
+BUFFER_PUBLICDEC const char* gap_buffer_view(Gap_buffer* buffer);
+BUFFER_PUBLICDEC Buffer gap_buffer_to_buffer(const Gap_buffer* buffer);
+BUFFER_PUBLICDEC void gap_buffer_free(Gap_buffer* buffer);
 
 #endif // _BUFFER_H
 
 #ifdef BUFFER_IMPL
 
+#if defined(TARGET_LINUX) || defined(TARGET_APPLE)
+  #include <sys/mman.h> // mmap, madvise, munmap
+  #include <sys/stat.h> // fstat
+  #include <sys/uio.h> // writev
+#endif
+
+// common.h only asks for sse, comparing bytes takes sse2
+#if defined(USE_SSE) && (defined(__SSE2__) || defined(_M_X64))
+  #define BUFFER_USE_SSE2
+  #include <emmintrin.h>
+#endif
+
+#if defined(TARGET_LINUX) && !defined(BUFFER_NO_IO_URING)
+  #define BUFFER_IO_URING
+  #include <linux/io_uring.h>
+  #include <linux/stat.h> // statx
+  #include <sys/syscall.h> // io_uring_setup, io_uring_enter
+  #include <sched.h> // sched_yield
+#endif
+
+static void buffer_grow(Buffer* buffer, size_t count);
+static void gap_buffer_grow(Gap_buffer* buffer, size_t count);
+static Result buffer_writer_write_all(Buffer_writer* writer, const char* data, size_t count);
+#ifdef USE_STB_SPRINTF
+static char* buffer_appendf_callback(const char* data, void* user, int count);
+#endif
+#ifdef BUFFER_USE_SSE2
+static u32 buffer_ctz(u32 mask);
+#endif
+static size_t buffer_find_byte_n(const char* data, size_t count, char byte);
+static size_t buffer_find_any_n(const char* data, size_t count, const char* set, size_t set_count);
+static size_t buffer_find_table_n(const char* data, size_t count, const char* set, size_t set_count, const u8* table);
+static size_t buffer_count_byte_n(const char* data, size_t count, char byte);
+static bool string_view_is_space(char c);
+#ifdef BUFFER_IO_URING
+typedef struct Buffer_uring {
+  i32 fd;
+  u32* sq_head;
+  u32* sq_tail;
+  u32* sq_mask;
+  u32* sq_array;
+  struct io_uring_sqe* sqes;
+  u32* cq_head;
+  u32* cq_tail;
+  u32* cq_mask;
+  struct io_uring_cqe* cqes;
+  void* sq_ring;
+  size_t sq_ring_size;
+  void* cq_ring;
+  size_t cq_ring_size;
+  size_t sqes_size;
+  u32 tail;     // tail of the submission queue that has not been published yet
+  u32 queued;   // entries that have not been submitted yet
+  u32 inflight; // entries that the kernel has taken but not completed yet
+} Buffer_uring;
+
+typedef enum Buffer_uring_op {
+  BUFFER_URING_OPEN,
+  BUFFER_URING_STAT,
+  BUFFER_URING_READ,
+  BUFFER_URING_CLOSE,
+} Buffer_uring_op;
+
+static Result buffer_uring_init(Buffer_uring* ring, u32 entries);
+static void buffer_uring_free(Buffer_uring* ring);
+static struct io_uring_sqe* buffer_uring_sqe(Buffer_uring* ring, size_t index, Buffer_uring_op op);
+static Result buffer_uring_enter(Buffer_uring* ring, u32 wait);
+static bool buffer_uring_cqe(Buffer_uring* ring, struct io_uring_cqe* cqe);
+static u32 buffer_uring_read(Buffer_uring* ring, size_t index, i32 fd, Buffer* buffer);
+static Result buffer_load_files_uring(const char** paths, size_t count, Buffer* buffers);
+#endif
+#ifdef _THREAD_H
+typedef struct Buffer_load_work {
+  const char** paths;
+  Buffer* buffers;
+  size_t count;
+  volatile size_t next;
+} Buffer_load_work;
+
+static void* buffer_load_files_worker(Buffer_load_work* work);
+#endif
+
+// write what is buffered followed by data, with one writev where possible. partial writes and EINTR are retried
+Result buffer_writer_write_all(Buffer_writer* writer, const char* data, size_t count) {
+  Buffer* buffer = &writer->buffer;
+#if defined(TARGET_LINUX) || defined(TARGET_APPLE)
+  struct iovec iov[2] = {
+    { .iov_base = buffer->data, .iov_len = buffer->count },
+    { .iov_base = (void*)data, .iov_len = count },
+  };
+  struct iovec* segment = buffer->count ? &iov[0] : &iov[1];
+  i32 segment_count = buffer->count ? 2 : 1;
+  while (segment_count > 0) {
+    ssize_t n = writev(writer->fd, segment, segment_count);
+    if (n < 0) {
+      continue_if(errno == EINTR);
+      writer->error = errno;
+      buffer->count = 0;
+      return Error;
+    }
+    while (segment_count > 0 && (size_t)n >= segment->iov_len) {
+      n -= segment->iov_len;
+      segment += 1;
+      segment_count -= 1;
+    }
+    if (segment_count > 0) {
+      segment->iov_base = (char*)segment->iov_base + n;
+      segment->iov_len -= n;
+    }
+  }
+#else
+  const char* segments[2] = { buffer->data, data };
+  size_t counts[2] = { buffer->count, count };
+  for (size_t i = 0; i < 2; ++i) {
+    size_t written = 0;
+    while (written < counts[i]) {
+      ssize_t n = write(writer->fd, segments[i] + written, counts[i] - written);
+      if (n < 0) {
+        continue_if(errno == EINTR);
+        writer->error = errno;
+        buffer->count = 0;
+        return Error;
+      }
+      written += n;
+    }
+  }
+#endif
+  buffer->count = 0;
+  return Ok;
+}
+
+#ifdef BUFFER_USE_SSE2
+u32 buffer_ctz(u32 mask) {
+#if defined(_MSC_VER) && !defined(__clang__)
+  unsigned long index = 0;
+  _BitScanForward(&index, mask);
+  return (u32)index;
+#else
+  return (u32)__builtin_ctz(mask);
+#endif
+}
+#endif
+
+// index of the first byte in data that matches, BUFFER_NOT_FOUND if there is none
+size_t buffer_find_byte_n(const char* data, size_t count, char byte) {
+  size_t i = 0;
+#ifdef BUFFER_USE_SSE2
+  __m128i needle = _mm_set1_epi8(byte);
+  for (; i + 16 <= count; i += 16) {
+    __m128i block = _mm_loadu_si128((const __m128i*)&data[i]);
+    u32 mask = (u32)_mm_movemask_epi8(_mm_cmpeq_epi8(block, needle));
+    if (mask) {
+      return i + buffer_ctz(mask);
+    }
+  }
+#endif
+  for (; i < count; ++i) {
+    if (data[i] == byte) {
+      return i;
+    }
+  }
+  return BUFFER_NOT_FOUND;
+}
+
+size_t buffer_find_any_n(const char* data, size_t count, const char* set, size_t set_count) {
+  u8 table[256] = {0};
+  for (size_t k = 0; k < set_count; ++k) {
+    table[(u8)set[k]] = 1;
+  }
+  return buffer_find_table_n(data, count, set, set_count, table);
+}
+
+// table has a nonzero entry for every byte in set, for callers that already built it. small sets are compared 16 bytes
+// at a time, larger ones and the tail go through the table
+size_t buffer_find_table_n(const char* data, size_t count, const char* set, size_t set_count, const u8* table) {
+  size_t i = 0;
+  if (set_count == 0) {
+    return BUFFER_NOT_FOUND;
+  }
+  if (set_count == 1) {
+    return buffer_find_byte_n(data, count, set[0]);
+  }
+#ifdef BUFFER_USE_SSE2
+  if (set_count <= 8) {
+    __m128i needles[8];
+    for (size_t k = 0; k < set_count; ++k) {
+      needles[k] = _mm_set1_epi8(set[k]);
+    }
+    for (; i + 16 <= count; i += 16) {
+      __m128i block = _mm_loadu_si128((const __m128i*)&data[i]);
+      __m128i matches = _mm_cmpeq_epi8(block, needles[0]);
+      for (size_t k = 1; k < set_count; ++k) {
+        matches = _mm_or_si128(matches, _mm_cmpeq_epi8(block, needles[k]));
+      }
+      u32 mask = (u32)_mm_movemask_epi8(matches);
+      if (mask) {
+        return i + buffer_ctz(mask);
+      }
+    }
+  }
+#endif
+  for (; i < count; ++i) {
+    if (table[(u8)data[i]]) {
+      return i;
+    }
+  }
+  return BUFFER_NOT_FOUND;
+}
+
+size_t buffer_count_byte_n(const char* data, size_t count, char byte) {
+  size_t result = 0;
+  size_t i = 0;
+#ifdef BUFFER_USE_SSE2
+  // a match is -1 in its lane, so subtracting the compare counts matches per lane. the 8 bit lane counters are
+  // summed up with sad before they can overflow
+  __m128i needle = _mm_set1_epi8(byte);
+  __m128i zero = _mm_setzero_si128();
+  while (i + 16 <= count) {
+    __m128i counts = zero;
+    size_t end = MIN(count - (count - i) % 16, i + 255 * 16);
+    for (; i < end; i += 16) {
+      __m128i block = _mm_loadu_si128((const __m128i*)&data[i]);
+      counts = _mm_sub_epi8(counts, _mm_cmpeq_epi8(block, needle));
+    }
+    __m128i sums = _mm_sad_epu8(counts, zero);
+    result += (size_t)_mm_cvtsi128_si32(sums) + (size_t)_mm_cvtsi128_si32(_mm_srli_si128(sums, 8));
+  }
+#endif
+  for (; i < count; ++i) {
+    result += data[i] == byte;
+  }
+  return result;
+}
+
+#ifdef USE_STB_SPRINTF
+// stb_sprintf has formatted count bytes into the tail of the buffer, make room for the next chunk
+char* buffer_appendf_callback(const char* data, void* user, int count) {
+  Buffer* buffer = (Buffer*)user;
+  (void)data;
+  buffer->count += count;
+  buffer_grow(buffer, STB_SPRINTF_MIN);
+  return &buffer->data[buffer->count];
+}
+#endif
+
+#ifdef BUFFER_IO_URING
+Result buffer_uring_init(Buffer_uring* ring, u32 entries) {
+  struct io_uring_params params;
+  memset(&params, 0, sizeof(params));
+  memset(ring, 0, sizeof(*ring));
+  ring->fd = (i32)syscall(__NR_io_uring_setup, entries, &params);
+  if (ring->fd < 0) {
+    return Error;
+  }
+  // openat, statx, read and close all arrived before fast poll did, so older kernels take the fallback
+#ifdef IORING_FEAT_FAST_POLL
+  if (!(params.features & IORING_FEAT_FAST_POLL)) {
+    close(ring->fd);
+    return Error;
+  }
+#endif
+  ring->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(u32);
+  ring->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+  ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+  ring->sq_ring = mmap(NULL, ring->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+  ring->cq_ring = mmap(NULL, ring->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING);
+  ring->sqes = (struct io_uring_sqe*)mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+  if (ring->sq_ring == MAP_FAILED || ring->cq_ring == MAP_FAILED || (void*)ring->sqes == MAP_FAILED) {
+    buffer_uring_free(ring);
+    return Error;
+  }
+  u8* sq = (u8*)ring->sq_ring;
+  u8* cq = (u8*)ring->cq_ring;
+  ring->sq_head = (u32*)(sq + params.sq_off.head);
+  ring->sq_tail = (u32*)(sq + params.sq_off.tail);
+  ring->sq_mask = (u32*)(sq + params.sq_off.ring_mask);
+  ring->sq_array = (u32*)(sq + params.sq_off.array);
+  ring->cq_head = (u32*)(cq + params.cq_off.head);
+  ring->cq_tail = (u32*)(cq + params.cq_off.tail);
+  ring->cq_mask = (u32*)(cq + params.cq_off.ring_mask);
+  ring->cqes = (struct io_uring_cqe*)(cq + params.cq_off.cqes);
+  ring->tail = *ring->sq_tail;
+  return Ok;
+}
+
+void buffer_uring_free(Buffer_uring* ring) {
+  if (ring->sq_ring && ring->sq_ring != MAP_FAILED) {
+    munmap(ring->sq_ring, ring->sq_ring_size);
+  }
+  if (ring->cq_ring && ring->cq_ring != MAP_FAILED) {
+    munmap(ring->cq_ring, ring->cq_ring_size);
+  }
+  if (ring->sqes && (void*)ring->sqes != MAP_FAILED) {
+    munmap(ring->sqes, ring->sqes_size);
+  }
+  close(ring->fd);
+  memset(ring, 0, sizeof(*ring));
+}
+
+// queue an operation on the file at index, it is published to the kernel by the next buffer_uring_enter
+struct io_uring_sqe* buffer_uring_sqe(Buffer_uring* ring, size_t index, Buffer_uring_op op) {
+  u32 slot = ring->tail & *ring->sq_mask;
+  struct io_uring_sqe* sqe = &ring->sqes[slot];
+  memset(sqe, 0, sizeof(*sqe));
+  sqe->user_data = ((u64)index << 2) | op;
+  ring->sq_array[slot] = slot;
+  ring->tail += 1;
+  ring->queued += 1;
+  return sqe;
+}
+
+// submit everything that has been queued and wait for at least wait completions, with a single syscall.
+// any other error means that the ring is broken, operations that were taken before that may still be in flight
+Result buffer_uring_enter(Buffer_uring* ring, u32 wait) {
+  __atomic_store_n(ring->sq_tail, ring->tail, __ATOMIC_RELEASE);
+  for (;;) {
+    i64 n = syscall(__NR_io_uring_enter, ring->fd, ring->queued, wait, IORING_ENTER_GETEVENTS, NULL, 0);
+    if (n < 0) {
+      continue_if(errno == EINTR || errno == EAGAIN || errno == EBUSY);
+      return Error;
+    }
+    ring->queued -= (u32)n;
+    ring->inflight += (u32)n;
+    if (ring->queued == 0) {
+      return Ok;
+    }
+  }
+}
+
+bool buffer_uring_cqe(Buffer_uring* ring, struct io_uring_cqe* cqe) {
+  u32 head = *ring->cq_head;
+  if (head == __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE)) {
+    return false;
+  }
+  *cqe = ring->cqes[head & *ring->cq_mask];
+  __atomic_store_n(ring->cq_head, head + 1, __ATOMIC_RELEASE);
+  ring->inflight -= 1;
+  return true;
+}
+
+// read into the unused part of the buffer, growing it first when it is full. returns the number of bytes asked for
+u32 buffer_uring_read(Buffer_uring* ring, size_t index, i32 fd, Buffer* buffer) {
+  if (buffer->count == buffer->size) {
+    size_t size = buffer->size ? buffer->size * 2 : BUFFER_FILE_READ_SIZE;
+    buffer->data = buffer_memory_realloc(buffer->data, size);
+    BUFFER_ASSERT(buffer->data != NULL);
+    buffer->size = size;
+  }
+  struct io_uring_sqe* sqe = buffer_uring_sqe(ring, index, BUFFER_URING_READ);
+  sqe->opcode = IORING_OP_READ;
+  sqe->fd = fd;
+  sqe->addr = (u64)(uintptr_t)&buffer->data[buffer->count];
+  sqe->len = (u32)MIN(buffer->size - buffer->count, (size_t)UINT32_MAX);
+  sqe->off = buffer->count;
+  return sqe->len;
+}
+
+// files are loaded in batches, every batch takes one syscall to open and stat all files, one per round of reads
+// (one round unless there are short reads) and one to close them again.
+// if the ring breaks, nothing is left open or allocated and the caller has to load the files some other way
+Result buffer_load_files_uring(const char** paths, size_t count, Buffer* buffers) {
+  Result result = Ok;
+  Buffer_uring ring;
+  if (buffer_uring_init(&ring, 2 * BUFFER_FILE_BATCH_SIZE) != Ok) {
+    return Error;
+  }
+  i32 fds[BUFFER_FILE_BATCH_SIZE];
+  struct statx stats[BUFFER_FILE_BATCH_SIZE];
+  bool failed[BUFFER_FILE_BATCH_SIZE];
+  u32 requested[BUFFER_FILE_BATCH_SIZE];
+  size_t batch_count = 0;
+  struct io_uring_cqe cqe;
+  for (size_t base = 0; base < count; base += BUFFER_FILE_BATCH_SIZE) {
+    batch_count = MIN(count - base, (size_t)BUFFER_FILE_BATCH_SIZE);
+    for (size_t i = 0; i < batch_count; ++i) {
+      fds[i] = -1;
+      failed[i] = false;
+      struct io_uring_sqe* sqe = buffer_uring_sqe(&ring, i, BUFFER_URING_OPEN);
+      sqe->opcode = IORING_OP_OPENAT;
+      sqe->fd = AT_FDCWD;
+      sqe->addr = (u64)(uintptr_t)paths[base + i];
+      sqe->open_flags = O_RDONLY;
+      sqe = buffer_uring_sqe(&ring, i, BUFFER_URING_STAT);
+      sqe->opcode = IORING_OP_STATX;
+      sqe->fd = AT_FDCWD;
+      sqe->addr = (u64)(uintptr_t)paths[base + i];
+      sqe->len = STATX_SIZE;
+      sqe->off = (u64)(uintptr_t)&stats[i];
+    }
+    size_t pending = 2 * batch_count;
+    while (pending > 0) {
+      if (buffer_uring_enter(&ring, pending) != Ok) {
+        return_defer(Error);
+      }
+      while (buffer_uring_cqe(&ring, &cqe)) {
+        size_t i = cqe.user_data >> 2;
+        if ((cqe.user_data & 3) == BUFFER_URING_OPEN) {
+          fds[i] = cqe.res;
+        }
+        failed[i] = failed[i] || cqe.res < 0;
+        pending -= 1;
+      }
+    }
+
+    for (size_t i = 0; i < batch_count; ++i) {
+      continue_if(failed[i]);
+      Buffer* buffer = &buffers[base + i];
+      size_t size = (size_t)stats[i].stx_size;
+      if (size > 0) {
+        // no need to clear it, all of it is read into
+        buffer->data = buffer_memory_malloc(size);
+        BUFFER_ASSERT(buffer->data != NULL);
+        buffer->size = size;
+      }
+      requested[i] = buffer_uring_read(&ring, i, fds[i], buffer);
+      pending += 1;
+    }
+    while (pending > 0) {
+      if (buffer_uring_enter(&ring, pending) != Ok) {
+        return_defer(Error);
+      }
+      while (buffer_uring_cqe(&ring, &cqe)) {
+        size_t i = cqe.user_data >> 2;
+        Buffer* buffer = &buffers[base + i];
+        pending -= 1;
+        if (cqe.res < 0) {
+          failed[i] = true;
+          continue;
+        }
+        buffer->count += cqe.res;
+        // done at the end of the file, or when the file was smaller than it said
+        size_t size = (size_t)stats[i].stx_size;
+        continue_if(cqe.res == 0 || (size > 0 ? buffer->count >= size : (u32)cqe.res < requested[i]));
+        requested[i] = buffer_uring_read(&ring, i, fds[i], buffer);
+        pending += 1;
+      }
+    }
+
+    for (size_t i = 0; i < batch_count; ++i) {
+      Buffer* buffer = &buffers[base + i];
+      if (failed[i] || buffer->count == 0) {
+        buffer_free(buffer);
+      }
+      else if (buffer->count < buffer->size) {
+        buffer->data = buffer_memory_realloc(buffer->data, buffer->count);
+        buffer->size = buffer->count;
+      }
+      continue_if(fds[i] < 0);
+      struct io_uring_sqe* sqe = buffer_uring_sqe(&ring, i, BUFFER_URING_CLOSE);
+      sqe->opcode = IORING_OP_CLOSE;
+      sqe->fd = fds[i];
+      pending += 1;
+    }
+    while (pending > 0) {
+      if (buffer_uring_enter(&ring, pending) != Ok) {
+        return_defer(Error);
+      }
+      while (buffer_uring_cqe(&ring, &cqe)) {
+        fds[cqe.user_data >> 2] = -1;
+        pending -= 1;
+      }
+    }
+  }
+defer:
+  if (result != Ok) {
+    // wait for what the kernel already took, so that nothing is read into the buffers after they are freed.
+    // completions are posted when this thread comes back from a syscall, which sched_yield is enough for
+    while (ring.inflight > 0) {
+      if (!buffer_uring_cqe(&ring, &cqe)) {
+        sched_yield();
+        continue;
+      }
+      size_t i = cqe.user_data >> 2;
+      if ((cqe.user_data & 3) == BUFFER_URING_OPEN) {
+        fds[i] = cqe.res;
+      }
+      else if ((cqe.user_data & 3) == BUFFER_URING_CLOSE) {
+        fds[i] = -1;
+      }
+    }
+    for (size_t i = 0; i < batch_count; ++i) {
+      if (fds[i] >= 0) {
+        close(fds[i]);
+      }
+    }
+    for (size_t i = 0; i < count; ++i) {
+      buffer_free(&buffers[i]);
+    }
+  }
+  buffer_uring_free(&ring);
+  return result;
+}
+#endif // BUFFER_IO_URING
+
+#ifdef _THREAD_H
+void* buffer_load_files_worker(Buffer_load_work* work) {
+  for (;;) {
+    size_t i = atomic_fetch_add(&work->next, 1);
+    break_if(i >= work->count);
+    work->buffers[i] = buffer_new_from_file(work->paths[i]);
+  }
+  return NULL;
+}
+#endif
+
+// make room for count more bytes and the null terminator
+void buffer_grow(Buffer* buffer, size_t count) {
+  size_t needed = buffer->count + count + 1;
+  if (needed <= buffer->size) {
+    return;
+  }
+  size_t new_size = buffer->size ? buffer->size : BUFFER_INIT_SIZE;
+  while (new_size < needed) {
+    size_t next_size = (size_t)(new_size * BUFFER_GROWTH_FACTOR);
+    new_size = next_size > new_size ? next_size : new_size + 1;
+  }
+  buffer_reserve(buffer, new_size);
+}
+
 BUFFER_PUBLICDEF
 Buffer buffer_new(size_t size) {
   Buffer buffer = (Buffer) {
@@ -121,25 +784,90 @@ void buffer_reset(Buffer* buffer) {
   buffer->count = 0;
 }
 
+// make sure at least size bytes are allocated, only the byte after the data is cleared
 BUFFER_PUBLICDEF
-void buffer_append(Buffer* buffer, char byte) {
-  if (buffer->count + sizeof(byte) >= buffer->size - 1) {
-    size_t new_size = buffer->size * 2;
-    if (!new_size) {
-      new_size = BUFFER_INIT_SIZE;
-    }
-    buffer->data = buffer_memory_realloc(buffer->data, new_size);
-    buffer->size = new_size;
-    memset(&buffer->data[buffer->count], 0, buffer->size - buffer->count);
+void buffer_reserve(Buffer* buffer, size_t size) {
+  if (size <= buffer->size) {
+    return;
   }
+  buffer->data = buffer_memory_realloc(buffer->data, size);
+  BUFFER_ASSERT(buffer->data != NULL);
+  buffer->size = size;
+  buffer->data[buffer->count] = 0;
+}
+
+BUFFER_PUBLICDEF
+void buffer_append(Buffer* buffer, char byte) {
+  buffer_grow(buffer, 1);
   buffer->data[buffer->count++] = byte;
+  buffer->data[buffer->count] = 0;
+}
+
+BUFFER_PUBLICDEF
+void buffer_append_n(Buffer* buffer, const char* data, size_t count) {
+  buffer_grow(buffer, count);
+  memcpy(&buffer->data[buffer->count], data, count);
+  buffer->count += count;
+  buffer->data[buffer->count] = 0;
+}
+
+BUFFER_PUBLICDEF
+void buffer_append_str(Buffer* buffer, const char* str) {
+  buffer_append_n(buffer, str, strlen(str));
+}
+
+// format onto the end of the buffer, it grows as needed. returns the number of bytes that were appended
+BUFFER_PUBLICDEF
+size_t buffer_appendf(Buffer* buffer, const char* fmt, ...) {
+  va_list argp;
+  va_start(argp, fmt);
+  size_t count = buffer_vappendf(buffer, fmt, argp);
+  va_end(argp);
+  return count;
+}
+
+BUFFER_PUBLICDEF
+size_t buffer_vappendf(Buffer* buffer, const char* fmt, va_list argp) {
+  size_t count = buffer->count;
+#ifdef USE_STB_SPRINTF
+  // formats straight into the tail, one STB_SPRINTF_MIN sized chunk at a time
+  buffer_grow(buffer, STB_SPRINTF_MIN);
+  stbsp_vsprintfcb(buffer_appendf_callback, buffer, &buffer->data[buffer->count], fmt, argp);
+#else
+  // vsnprintf reports how much it needed, so at most one more attempt is made after growing
+  buffer_grow(buffer, BUFFER_INIT_SIZE);
+  va_list copy;
+  va_copy(copy, argp);
+  i32 n = vsnprintf(&buffer->data[count], buffer->size - count, fmt, copy);
+  va_end(copy);
+  if (n < 0) {
+    buffer->data[count] = 0;
+    return 0;
+  }
+  if ((size_t)n >= buffer->size - count) {
+    buffer_grow(buffer, n);
+    vsnprintf(&buffer->data[count], buffer->size - count, fmt, argp);
+  }
+  buffer->count += n;
+#endif
+  buffer->data[buffer->count] = 0;
+  return buffer->count - count;
 }
 
 BUFFER_PUBLICDEF
 void buffer_insert(Buffer* buffer, char byte, size_t index) {
-  buffer_append(buffer, 0);
-  memmove(&buffer->data[index + 1], &buffer->data[index], buffer->count - index + 1);
-  buffer->data[index] = byte;
+  buffer_insert_n(buffer, &byte, 1, index);
+}
+
+// data must not point into the buffer itself
+BUFFER_PUBLICDEF
+void buffer_insert_n(Buffer* buffer, const char* data, size_t count, size_t index) {
+  BUFFER_ASSERT(index <= buffer->count);
+  buffer_grow(buffer, count);
+  memmove(&buffer->data[index + count], &buffer->data[index], buffer->count - index);
+  memcpy(&buffer->data[index], data, count);
+  buffer->count += count;
+  buffer->data[buffer->count] = 0;
 }
 
 BUFFER_PUBLICDEF
@@ -165,15 +893,29 @@ void buffer_free(Buffer* buffer) {
 
 BUFFER_PUBLICDEF
 Buffer buffer_new_from_fd(int fd) {
-  size_t file_size = lseek(fd, 0, SEEK_END);
-  lseek(fd, 0, SEEK_SET);
-  Buffer buffer = buffer_new(file_size);
-  if (read(fd, buffer.data, file_size) == (ssize_t)file_size) {
-    buffer.count = file_size;
-    buffer.size = file_size;
+  // pipes and files like the ones in /proc can not be measured this way, see Buffer_reader
+  off_t end = lseek(fd, 0, SEEK_END);
+  if (end < 0 || lseek(fd, 0, SEEK_SET) < 0) {
+    return (Buffer) { .data = NULL, .count = 0, .size = 0, };
   }
-  else {
-    buffer_free(&buffer);
+  size_t file_size = (size_t)end;
+  // every byte is overwritten by the read, so there is no need to clear it first
+  Buffer buffer = (Buffer) {
+    .data = buffer_memory_malloc(file_size),
+    .count = 0,
+    .size = file_size,
+  };
+  if (!buffer.data) {
+    buffer.size = 0;
+    return buffer;
+  }
+  while (buffer.count < file_size) {
+    ssize_t n = read(fd, &buffer.data[buffer.count], file_size - buffer.count);
+    if (n <= 0) {
+      buffer_free(&buffer);
+      return buffer;
+    }
+    buffer.count += n;
   }
   return buffer;
 }
@@ -194,4 +936,644 @@ Buffer buffer_new_from_file(const char* path) {
   return buffer;
 }
 
+// map the file read-only instead of copying it, the buffer must be released with buffer_free_mapped and not be
+// appended to. on platforms without mmap the file is read into memory instead
+BUFFER_PUBLICDEF
+Buffer buffer_new_from_fd_mapped(int fd, Buffer_advice advice) {
+  Buffer buffer = (Buffer) {
+    .data = NULL,
+    .count = 0,
+    .size = 0,
+  };
+#if defined(TARGET_LINUX) || defined(TARGET_APPLE)
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+    return buffer;
+  }
+  size_t file_size = (size_t)st.st_size;
+  void* data = mmap(NULL, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (data == MAP_FAILED) {
+    return buffer;
+  }
+  switch (advice) {
+    case BUFFER_ADVICE_SEQUENTIAL:
+      madvise(data, file_size, MADV_SEQUENTIAL);
+      break;
+    case BUFFER_ADVICE_WILLNEED:
+      madvise(data, file_size, MADV_WILLNEED);
+      break;
+    default:
+      break;
+  }
+  buffer.data = (char*)data;
+  buffer.count = file_size;
+  buffer.size = file_size;
+#else
+  (void)advice;
+  buffer = buffer_new_from_fd(fd);
+#endif
+  return buffer;
+}
+
+BUFFER_PUBLICDEF
+Buffer buffer_new_from_file_mapped(const char* path, Buffer_advice advice) {
+  Buffer buffer = (Buffer) {
+    .data = NULL,
+    .count = 0,
+    .size = 0,
+  };
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    return buffer;
+  }
+  // the mapping stays valid after the file is closed
+  buffer = buffer_new_from_fd_mapped(fd, advice);
+  close(fd);
+  return buffer;
+}
+
+BUFFER_PUBLICDEF
+void buffer_free_mapped(Buffer* buffer) {
+#if defined(TARGET_LINUX) || defined(TARGET_APPLE)
+  if (buffer->data) {
+    munmap(buffer->data, buffer->size);
+    buffer->data = NULL;
+  }
+  buffer->count = 0;
+  buffer->size = 0;
+#else
+  buffer_free(buffer);
+#endif
+}
+
+// size is the size of the window, 0 for BUFFER_READER_SIZE
+BUFFER_PUBLICDEF
+Buffer_reader buffer_reader_new(int fd, size_t size) {
+  Buffer_reader reader = (Buffer_reader) {
+    .fd = fd,
+    .window = buffer_new(size ? size : BUFFER_READER_SIZE),
+    .index = 0,
+    .eof = false,
+    .error = 0,
+  };
+  return reader;
+}
+
+// try to have at least count unconsumed bytes in the window, reading as many times as needed. returns how many
+// there are, which is less than count only at the end of the stream, on error, or if count does not fit the window
+BUFFER_PUBLICDEF
+size_t buffer_reader_fill(Buffer_reader* reader, size_t count) {
+  Buffer* window = &reader->window;
+  if (count > window->size) {
+    count = window->size;
+  }
+  size_t available = window->count - reader->index;
+  if (available >= count || reader->eof || reader->error) {
+    return available;
+  }
+  // move what is left to the front so that the rest of the window can be filled
+  if (reader->index > 0) {
+    memmove(window->data, &window->data[reader->index], available);
+    window->count = available;
+    reader->index = 0;
+  }
+  while (window->count < count) {
+    ssize_t n = read(reader->fd, &window->data[window->count], window->size - window->count);
+    if (n < 0) {
+      continue_if(errno == EINTR);
+      reader->error = errno;
+      break;
+    }
+    if (n == 0) {
+      reader->eof = true;
+      break;
+    }
+    window->count += n;
+  }
+  return window->count - reader->index;
+}
+
+// point data at up to count unconsumed bytes without consuming them
+BUFFER_PUBLICDEF
+size_t buffer_reader_peek(Buffer_reader* reader, const char** data, size_t count) {
+  size_t available = buffer_reader_fill(reader, count);
+  *data = &reader->window.data[reader->index];
+  return available < count ? available : count;
+}
+
+BUFFER_PUBLICDEF
+void buffer_reader_consume(Buffer_reader* reader, size_t count) {
+  BUFFER_ASSERT(count <= reader->window.count - reader->index);
+  reader->index += count;
+}
+
+// copy up to count bytes into data, fewer only at the end of the stream or on error
+BUFFER_PUBLICDEF
+size_t buffer_reader_read(Buffer_reader* reader, char* data, size_t count) {
+  size_t total = 0;
+  while (total < count) {
+    size_t available = buffer_reader_fill(reader, 1);
+    break_if(available == 0);
+    size_t n = count - total < available ? count - total : available;
+    memcpy(&data[total], &reader->window.data[reader->index], n);
+    reader->index += n;
+    total += n;
+  }
+  return total;
+}
+
+// append everything up to and including the delimiter to out, lines can be longer than the window.
+// returns the number of bytes appended, 0 at the end of the stream
+BUFFER_PUBLICDEF
+size_t buffer_reader_read_until(Buffer_reader* reader, char delimiter, Buffer* out) {
+  size_t total = 0;
+  for (;;) {
+    size_t available = buffer_reader_fill(reader, 1);
+    break_if(available == 0);
+    const char* data = &reader->window.data[reader->index];
+    const char* found = (const char*)memchr(data, delimiter, available);
+    size_t n = found ? (size_t)(found - data) + 1 : available;
+    buffer_append_n(out, data, n);
+    reader->index += n;
+    total += n;
+    break_if(found != NULL);
+  }
+  return total;
+}
+
+BUFFER_PUBLICDEF
+void buffer_reader_free(Buffer_reader* reader) {
+  buffer_free(&reader->window);
+  reader->index = 0;
+}
+
+// load many files at once, with io_uring where it is available and otherwise with a pool of threads when thread.h
+// was included first. files that could not be read have no data. the buffers are released with buffer_free_files
+BUFFER_PUBLICDEF
+Buffer* buffer_new_from_files(const char** paths, size_t count) {
+  Buffer* buffers = (Buffer*)buffer_memory_calloc(count ? count : 1, sizeof(Buffer));
+  BUFFER_ASSERT(buffers != NULL);
+#ifdef BUFFER_IO_URING
+  if (buffer_files_io_uring && buffer_load_files_uring(paths, count, buffers) == Ok) {
+    return buffers;
+  }
+#endif
+#ifdef _THREAD_H
+  Buffer_load_work work = (Buffer_load_work) {
+    .paths = paths,
+    .buffers = buffers,
+    .count = count,
+    .next = 0,
+  };
+  i32 ids[NPROC] = {0};
+  size_t thread_count = MIN(count, (size_t)NPROC);
+  for (size_t i = 0; i < thread_count; ++i) {
+    ids[i] = thread_create_v2((void*)buffer_load_files_worker, &work);
+  }
+  // whatever the threads did not get to, including when they could not be created
+  buffer_load_files_worker(&work);
+  for (size_t i = 0; i < thread_count; ++i) {
+    if (ids[i] >= 0) {
+      thread_join(ids[i]);
+    }
+  }
+#else
+  for (size_t i = 0; i < count; ++i) {
+    buffers[i] = buffer_new_from_file(paths[i]);
+  }
+#endif
+  return buffers;
+}
+
+BUFFER_PUBLICDEF
+void buffer_free_files(Buffer* buffers, size_t count) {
+  if (!buffers) {
+    return;
+  }
+  for (size_t i = 0; i < count; ++i) {
+    buffer_free(&buffers[i]);
+  }
+  buffer_memory_free(buffers);
+}
+
+BUFFER_PUBLICDEF
+size_t buffer_find_byte(const Buffer* buffer, size_t start, char byte) {
+  if (start >= buffer->count) {
+    return BUFFER_NOT_FOUND;
+  }
+  size_t index = buffer_find_byte_n(&buffer->data[start], buffer->count - start, byte);
+  return index == BUFFER_NOT_FOUND ? index : start + index;
+}
+
+// first byte from start on that is in set
+BUFFER_PUBLICDEF
+size_t buffer_find_any(const Buffer* buffer, size_t start, const char* set, size_t set_count) {
+  if (start >= buffer->count) {
+    return BUFFER_NOT_FOUND;
+  }
+  size_t index = buffer_find_any_n(&buffer->data[start], buffer->count - start, set, set_count);
+  return index == BUFFER_NOT_FOUND ? index : start + index;
+}
+
+BUFFER_PUBLICDEF
+size_t buffer_count_byte(const Buffer* buffer, char byte) {
+  return buffer_count_byte_n(buffer->data, buffer->count, byte);
+}
+
+// one pass to count the newlines so the offsets can be allocated up front, and one to fill them in
+BUFFER_PUBLICDEF
+Buffer_lines buffer_lines_new(const Buffer* buffer) {
+  Buffer_lines lines = (Buffer_lines) {
+    .offsets = NULL,
+    .count = buffer_count_byte(buffer, '\n') + 1,
+  };
+  lines.offsets = (size_t*)buffer_memory_malloc((lines.count + 1) * sizeof(size_t));
+  BUFFER_ASSERT(lines.offsets != NULL);
+  size_t line = 0;
+  lines.offsets[line++] = 0;
+  const char* data = buffer->data;
+  size_t i = 0;
+#ifdef BUFFER_USE_SSE2
+  __m128i newline = _mm_set1_epi8('\n');
+  for (; i + 16 <= buffer->count; i += 16) {
+    __m128i block = _mm_loadu_si128((const __m128i*)&data[i]);
+    u32 mask = (u32)_mm_movemask_epi8(_mm_cmpeq_epi8(block, newline));
+    while (mask) {
+      lines.offsets[line++] = i + buffer_ctz(mask) + 1;
+      mask &= mask - 1;
+    }
+  }
+#endif
+  for (; i < buffer->count; ++i) {
+    if (data[i] == '\n') {
+      lines.offsets[line++] = i + 1;
+    }
+  }
+  lines.offsets[line] = buffer->count + 1;
+  return lines;
+}
+
+// start of a line and its length without the newline
+BUFFER_PUBLICDEF
+const char* buffer_line(const Buffer* buffer, const Buffer_lines* lines, size_t line, size_t* length) {
+  BUFFER_ASSERT(line < lines->count);
+  size_t start = lines->offsets[line];
+  if (length) {
+    *length = lines->offsets[line + 1] - start - 1;
+  }
+  return &buffer->data[start];
+}
+
+BUFFER_PUBLICDEF
+void buffer_lines_free(Buffer_lines* lines) {
+  if (lines->offsets) {
+    buffer_memory_free(lines->offsets);
+    lines->offsets = NULL;
+  }
+  lines->count = 0;
+}
+
+bool string_view_is_space(char c) {
+  return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' || c == '\f';
+}
+
+BUFFER_PUBLICDEF
+String_view string_view_new(const char* data, size_t count) {
+  return (String_view) {
+    .data = data,
+    .count = count,
+  };
+}
+
+BUFFER_PUBLICDEF
+String_view string_view_from_str(const char* str) {
+  return string_view_new(str, strlen(str));
+}
+
+BUFFER_PUBLICDEF
+String_view string_view_from_buffer(const Buffer* buffer) {
+  return string_view_new(buffer->data, buffer->count);
+}
+
+// count bytes from start on, both are clamped to the view
+BUFFER_PUBLICDEF
+String_view string_view_slice(String_view view, size_t start, size_t count) {
+  if (start > view.count) {
+    start = view.count;
+  }
+  if (count > view.count - start) {
+    count = view.count - start;
+  }
+  return string_view_new(view.data + start, count);
+}
+
+BUFFER_PUBLICDEF
+String_view string_view_trim(String_view view) {
+  return string_view_trim_right(string_view_trim_left(view));
+}
+
+BUFFER_PUBLICDEF
+String_view string_view_trim_left(String_view view) {
+  size_t i = 0;
+  while (i < view.count && string_view_is_space(view.data[i])) {
+    i += 1;
+  }
+  return string_view_new(view.data + i, view.count - i);
+}
+
+BUFFER_PUBLICDEF
+String_view string_view_trim_right(String_view view) {
+  size_t count = view.count;
+  while (count > 0 && string_view_is_space(view.data[count - 1])) {
+    count -= 1;
+  }
+  return string_view_new(view.data, count);
+}
+
+BUFFER_PUBLICDEF
+size_t string_view_find_byte(String_view view, char byte) {
+  return buffer_find_byte_n(view.data, view.count, byte);
+}
+
+// index of the first occurrence of needle, BUFFER_NOT_FOUND if there is none. an empty needle is found at 0
+BUFFER_PUBLICDEF
+size_t string_view_find(String_view view, String_view needle) {
+  if (needle.count == 0) {
+    return 0;
+  }
+  size_t i = 0;
+  while (i + needle.count <= view.count) {
+    size_t index = buffer_find_byte_n(&view.data[i], view.count - i - needle.count + 1, needle.data[0]);
+    break_if(index == BUFFER_NOT_FOUND);
+    i += index;
+    if (memcmp(&view.data[i], needle.data, needle.count) == 0) {
+      return i;
+    }
+    i += 1;
+  }
+  return BUFFER_NOT_FOUND;
+}
+
+BUFFER_PUBLICDEF
+bool string_view_equal(String_view a, String_view b) {
+  return a.count == b.count && (a.count == 0 || memcmp(a.data, b.data, a.count) == 0);
+}
+
+// ordered like strcmp, a view that is a prefix of the other comes first
+BUFFER_PUBLICDEF
+i32 string_view_compare(String_view a, String_view b) {
+  size_t count = a.count < b.count ? a.count : b.count;
+  i32 result = count ? memcmp(a.data, b.data, count) : 0;
+  if (result != 0) {
+    return result;
+  }
+  return (a.count > b.count) - (a.count < b.count);
+}
+
+BUFFER_PUBLICDEF
+bool string_view_starts_with(String_view view, String_view prefix) {
+  return prefix.count <= view.count && (prefix.count == 0 || memcmp(view.data, prefix.data, prefix.count) == 0);
+}
+
+// take everything up to the delimiter off the front of view, the delimiter itself is skipped. without a delimiter
+// the whole view is taken
+BUFFER_PUBLICDEF
+String_view string_view_split(String_view* view, char delimiter) {
+  size_t index = string_view_find_byte(*view, delimiter);
+  if (index == BUFFER_NOT_FOUND) {
+    String_view result = *view;
+    *view = string_view_new(view->data + view->count, 0);
+    return result;
+  }
+  String_view result = string_view_new(view->data, index);
+  *view = string_view_new(view->data + index + 1, view->count - index - 1);
+  return result;
+}
+
+// take the next token off the front of view, runs of delimiters are skipped so there are no empty tokens. returns
+// false when there are no tokens left
+BUFFER_PUBLICDEF
+bool string_view_token(String_view* view, const char* delimiters, String_view* token) {
+  size_t delimiter_count = strlen(delimiters);
+  u8 table[256] = {0};
+  for (size_t k = 0; k < delimiter_count; ++k) {
+    table[(u8)delimiters[k]] = 1;
+  }
+  size_t start = 0;
+  while (start < view->count && table[(u8)view->data[start]]) {
+    start += 1;
+  }
+  if (start == view->count) {
+    *view = string_view_new(view->data + view->count, 0);
+    return false;
+  }
+  size_t end = buffer_find_table_n(&view->data[start], view->count - start, delimiters, delimiter_count, table);
+  end = end == BUFFER_NOT_FOUND ? view->count : start + end;
+  *token = string_view_new(&view->data[start], end - start);
+  *view = string_view_new(view->data + end, view->count - end);
+  return true;
+}
+
+// copy into a new, null terminated Buffer
+BUFFER_PUBLICDEF
+Buffer string_view_to_buffer(String_view view) {
+  Buffer buffer = (Buffer) {
+    .data = buffer_memory_malloc(view.count + 1),
+    .count = view.count,
+    .size = view.count + 1,
+  };
+  BUFFER_ASSERT(buffer.data != NULL);
+  if (view.count) {
+    memcpy(buffer.data, view.data, view.count);
+  }
+  buffer.data[view.count] = 0;
+  return buffer;
+}
+
+// threshold is the number of bytes to collect before writing, 0 for BUFFER_WRITER_SIZE
+BUFFER_PUBLICDEF
+Buffer_writer buffer_writer_new(int fd, size_t threshold, int flags) {
+  Buffer_writer writer = (Buffer_writer) {
+    .fd = fd,
+    .buffer = buffer_new(0),
+    .threshold = threshold ? threshold : BUFFER_WRITER_SIZE,
+    .flags = flags,
+    .error = 0,
+  };
+  buffer_reserve(&writer.buffer, writer.threshold + 1);
+  return writer;
+}
+
+// data that would go over the threshold is written together with what is buffered instead of being copied first
+BUFFER_PUBLICDEF
+Result buffer_writer_write(Buffer_writer* writer, const char* data, size_t count) {
+  if (writer->buffer.count + count >= writer->threshold) {
+    return buffer_writer_write_all(writer, data, count);
+  }
+  buffer_append_n(&writer->buffer, data, count);
+  if ((writer->flags & BUFFER_WRITER_LINE) && memchr(data, '\n', count)) {
+    return buffer_writer_flush(writer);
+  }
+  return Ok;
+}
+
+BUFFER_PUBLICDEF
+Result buffer_writer_write_str(Buffer_writer* writer, const char* str) {
+  return buffer_writer_write(writer, str, strlen(str));
+}
+
+BUFFER_PUBLICDEF
+Result buffer_writer_flush(Buffer_writer* writer) {
+  if (writer->buffer.count == 0) {
+    return Ok;
+  }
+  return buffer_writer_write_all(writer, NULL, 0);
+}
+
+// flush what is left, the fd is not closed
+BUFFER_PUBLICDEF
+Result buffer_writer_free(Buffer_writer* writer) {
+  Result result = buffer_writer_flush(writer);
+  buffer_free(&writer->buffer);
+  return result;
+}
+
+// make the gap at least count bytes large, the text after the gap is moved to the end of the new allocation
+void gap_buffer_grow(Gap_buffer* buffer, size_t count) {
+  size_t gap = buffer->gap_end - buffer->gap_start;
+  if (gap >= count) {
+    return;
+  }
+  size_t needed = buffer->size - gap + count;
+  size_t new_size = buffer->size ? buffer->size : BUFFER_INIT_SIZE;
+  while (new_size < needed) {
+    size_t next_size = (size_t)(new_size * BUFFER_GROWTH_FACTOR);
+    new_size = next_size > new_size ? next_size : new_size + 1;
+  }
+  size_t tail = buffer->size - buffer->gap_end;
+  buffer->data = buffer_memory_realloc(buffer->data, new_size);
+  BUFFER_ASSERT(buffer->data != NULL);
+  memmove(&buffer->data[new_size - tail], &buffer->data[buffer->gap_end], tail);
+  buffer->gap_end = new_size - tail;
+  buffer->size = new_size;
+}
+
+BUFFER_PUBLICDEF
+Gap_buffer gap_buffer_new(size_t size) {
+  Gap_buffer buffer = (Gap_buffer) {
+    .data = size ? buffer_memory_malloc(size) : NULL,
+    .size = size,
+    .gap_start = 0,
+    .gap_end = size,
+  };
+  BUFFER_ASSERT(buffer.data != NULL || size == 0);
+  return buffer;
+}
+
+BUFFER_PUBLICDEF
+size_t gap_buffer_count(const Gap_buffer* buffer) {
+  return buffer->size - (buffer->gap_end - buffer->gap_start);
+}
+
+BUFFER_PUBLICDEF
+char gap_buffer_at(const Gap_buffer* buffer, size_t index) {
+  BUFFER_ASSERT(index < gap_buffer_count(buffer));
+  if (index < buffer->gap_start) {
+    return buffer->data[index];
+  }
+  return buffer->data[index + (buffer->gap_end - buffer->gap_start)];
+}
+
+// move the gap so that it starts at index, only the text between the old and the new position is moved
+BUFFER_PUBLICDEF
+void gap_buffer_move(Gap_buffer* buffer, size_t index) {
+  BUFFER_ASSERT(index <= gap_buffer_count(buffer));
+  if (index < buffer->gap_start) {
+    size_t count = buffer->gap_start - index;
+    memmove(&buffer->data[buffer->gap_end - count], &buffer->data[index], count);
+    buffer->gap_start -= count;
+    buffer->gap_end -= count;
+  }
+  else if (index > buffer->gap_start) {
+    size_t count = index - buffer->gap_start;
+    memmove(&buffer->data[buffer->gap_start], &buffer->data[buffer->gap_end], count);
+    buffer->gap_start += count;
+    buffer->gap_end += count;
+  }
+}
+
+BUFFER_PUBLICDEF
+void gap_buffer_append(Gap_buffer* buffer, char byte) {
+  gap_buffer_insert_n(buffer, &byte, 1, gap_buffer_count(buffer));
+}
+
+BUFFER_PUBLICDEF
+void gap_buffer_append_n(Gap_buffer* buffer, const char* data, size_t count) {
+  gap_buffer_insert_n(buffer, data, count, gap_buffer_count(buffer));
+}
+
+BUFFER_PUBLICDEF
+void gap_buffer_insert(Gap_buffer* buffer, char byte, size_t index) {
+  gap_buffer_insert_n(buffer, &byte, 1, index);
+}
+
+// data must not point into the buffer itself
+BUFFER_PUBLICDEF
+void gap_buffer_insert_n(Gap_buffer* buffer, const char* data, size_t count, size_t index) {
+  gap_buffer_move(buffer, index);
+  gap_buffer_grow(buffer, count);
+  memcpy(&buffer->data[buffer->gap_start], data, count);
+  buffer->gap_start += count;
+}
+
+BUFFER_PUBLICDEF
+void gap_buffer_erase(Gap_buffer* buffer, size_t index) {
+  gap_buffer_erase_n(buffer, index, 1);
+}
+
+// erasing only widens the gap, nothing is moved if the gap already is at index
+BUFFER_PUBLICDEF
+void gap_buffer_erase_n(Gap_buffer* buffer, size_t index, size_t count) {
+  BUFFER_ASSERT(index + count <= gap_buffer_count(buffer));
+  gap_buffer_move(buffer, index);
+  buffer->gap_end += count;
+}
+
+// move the gap to the end and return the text as one null terminated string, valid until the next edit
+BUFFER_PUBLICDEF
+const char* gap_buffer_view(Gap_buffer* buffer) {
+  size_t count = gap_buffer_count(buffer);
+  gap_buffer_move(buffer, count);
+  gap_buffer_grow(buffer, 1);
+  buffer->data[count] = 0;
+  return buffer->data;
+}
+
+BUFFER_PUBLICDEF
+Buffer gap_buffer_to_buffer(const Gap_buffer* buffer) {
+  size_t count = gap_buffer_count(buffer);
+  Buffer result = (Buffer) {
+    .data = buffer_memory_malloc(count + 1),
+    .count = count,
+    .size = count + 1,
+  };
+  BUFFER_ASSERT(result.data != NULL);
+  memcpy(result.data, buffer->data, buffer->gap_start);
+  memcpy(&result.data[buffer->gap_start], &buffer->data[buffer->gap_end], buffer->size - buffer->gap_end);
+  result.data[count] = 0;
+  return result;
+}
+
+BUFFER_PUBLICDEF
+void gap_buffer_free(Gap_buffer* buffer) {
+  if (buffer->data) {
+    buffer_memory_free(buffer->data);
+    buffer->data = NULL;
+  }
+  buffer->size = 0;
+  buffer->gap_start = 0;
+  buffer->gap_end = 0;
+}
+
 #endif // BUFFER_IMPL
+#undef BUFFER_IMPL
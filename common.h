@@ -137,6 +137,16 @@ typedef uint8_t   u8;
   #define COMMON_PUBLICDEF
 #endif
 
+#ifndef THREAD_LOCAL
+  #if defined(__cplusplus)
+    #define THREAD_LOCAL thread_local
+  #elif defined(_MSC_VER)
+    #define THREAD_LOCAL __declspec(thread)
+  #else
+    #define THREAD_LOCAL __thread
+  #endif
+#endif
+
 #ifndef MAX_PATH_LENGTH
   #define MAX_PATH_LENGTH 512
 #endif
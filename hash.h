@@ -0,0 +1,390 @@
+// hash.h
+// fast non-cryptographic 64 bit hashing, one-shot and streaming
+
+// macros:
+//  HASH_IMPLEMENTATION
+
+#ifndef _HASH_H
+#define _HASH_H
+
+#include "common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// inputs up to this size are hashed with the short (scalar) path, larger inputs go through the striped accumulator
+#define HASH_SHORT_MAX 256
+#define HASH_STRIPE_SIZE 64
+#define HASH_STRIPE_LANES 8
+#define HASH_SECRET_COUNT 32
+
+typedef struct Hash_state {
+  u64 acc[HASH_STRIPE_LANES];
+  u64 secret[HASH_SECRET_COUNT];
+  u8 buffer[HASH_SHORT_MAX]; // unprocessed tail, the last stripe before it is kept at the end
+  size_t buffered;
+  size_t stripes;            // stripes accumulated in the current block
+  u64 total;
+  u64 seed;
+} Hash_state;
+
+COMMON_PUBLICDEC u64 hash64(const void* data, const size_t count);
+COMMON_PUBLICDEC u64 hash64_seed(const void* data, const size_t count, const u64 seed);
+COMMON_PUBLICDEC u64 hash_str(const char* str);
+COMMON_PUBLICDEC Hash_state hash_state_new(const u64 seed);
+COMMON_PUBLICDEC void hash_update(Hash_state* state, const void* data, const size_t count);
+COMMON_PUBLICDEC u64 hash_digest(const Hash_state* state);
+
+#ifdef _BUFFER_H
+COMMON_PUBLICDEC u64 hash_buffer(const Buffer* buffer);
+COMMON_PUBLICDEC u64 hash_string_view(const String_view view);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _HASH_H
+
+#ifdef HASH_IMPLEMENTATION
+
+#if defined(USE_SSE) && (defined(__SSE2__) || defined(_M_X64))
+  #define HASH_USE_SSE2
+  #include <emmintrin.h>
+#endif
+
+#if defined(_MSC_VER) && defined(_M_X64) && !defined(__SIZEOF_INT128__)
+  #include <intrin.h>
+#endif
+
+#define HASH_BLOCK_STRIPES 16 // stripe n of a block is keyed with secret[n..n+8), then the accumulators are scrambled
+#define HASH_SCRAMBLE_KEY 24
+#define HASH_LAST_KEY 17
+#define HASH_MERGE_KEY 11
+
+#define HASH_PRIME32_1 0x9e3779b1u
+#define HASH_PRIME32_2 0x85ebca77u
+#define HASH_PRIME32_3 0xc2b2ae3du
+#define HASH_PRIME64_1 0x9e3779b185ebca87ull
+#define HASH_PRIME64_2 0xc2b2ae3d27d4eb4full
+#define HASH_PRIME64_3 0x165667b19e3779f9ull
+#define HASH_PRIME64_4 0x85ebca77c2b2ae63ull
+#define HASH_PRIME64_5 0x27d4eb2f165667c5ull
+
+static const u64 hash_secret[HASH_SECRET_COUNT] = {
+  0x1ac046dda8e86e2aull, 0xbe2c3b00b1d348c8ull, 0x9b1a66a95412ff75ull, 0xc448c2b1f05f7e4cull,
+  0xc111ca6b8f6e73c4ull, 0xb54861920d05b01dull, 0x8d61500f4a7bbe16ull, 0x5e0c25471f89e02eull,
+  0x48105a3d28f0e221ull, 0x2169f8846b637746ull, 0x3d628782e0c0d863ull, 0xa5ddb2216078aa40ull,
+  0xc8119d17f0571101ull, 0x98e2e2eb8f33280full, 0x8cd1e28860679cc4ull, 0x9dca6189c923aef3ull,
+  0x9d8d3071ba4f04c4ull, 0x5d395ada34220c26ull, 0xe6de42a441a1e28eull, 0x308fbf68cc864f59ull,
+  0x216a3c81332862f9ull, 0xbaceca0a77f3132eull, 0xdf2a2215339ca69cull, 0x3e4c11a103a5d859ull,
+  0x6d0f173ffec5f603ull, 0x0bf4bc630d193bb6ull, 0x5f76c4ad104b57fdull, 0x99ca459f4e93f651ull,
+  0x4751799d68cf88a0ull, 0xa6b1639e3b42b61cull, 0x278b01031924ea35ull, 0x430253eb7e993605ull,
+};
+
+static u64 hash_read64(const u8* p);
+static u64 hash_read32(const u8* p);
+static void hash_mum(u64* a, u64* b);
+static u64 hash_mix(u64 a, u64 b);
+static u64 hash_avalanche(u64 h);
+static u64 hash_short(const u8* p, const size_t count, u64 seed);
+static void hash_secret_init(u64* secret, const u64 seed);
+static void hash_acc_init(u64* acc);
+static void hash_accumulate(u64* acc, const u8* stripe, const u64* key);
+static void hash_scramble(u64* acc, const u64* key);
+static void hash_stripes(u64* acc, size_t* stripes, const u8* p, const size_t count, const u64* secret);
+static u64 hash_long_finish(u64* acc, const u8* last_stripe, const u64* secret, const u64 total);
+static u64 hash_long(const u8* p, const size_t count, const u64* secret);
+
+// little-endian loads, unaligned access is fine
+u64 hash_read64(const u8* p) {
+  u64 v;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+u64 hash_read32(const u8* p) {
+  u32 v;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+// full 64x64 -> 128 bit multiply, low half in a and high half in b
+void hash_mum(u64* a, u64* b) {
+#if defined(__SIZEOF_INT128__)
+  __uint128_t r = (__uint128_t)*a * *b;
+  *a = (u64)r;
+  *b = (u64)(r >> 64);
+#elif defined(_MSC_VER) && defined(_M_X64)
+  *a = _umul128(*a, *b, b);
+#else
+  u64 ha = *a >> 32, hb = *b >> 32, la = (u32)*a, lb = (u32)*b;
+  u64 rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+  u64 t = rl + (rm0 << 32);
+  u64 c = t < rl;
+  u64 lo = t + (rm1 << 32);
+  c += lo < t;
+  u64 hi = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+  *a = lo;
+  *b = hi;
+#endif
+}
+
+u64 hash_mix(u64 a, u64 b) {
+  hash_mum(&a, &b);
+  return a ^ b;
+}
+
+u64 hash_avalanche(u64 h) {
+  h ^= h >> 37;
+  h *= HASH_PRIME64_3;
+  h ^= h >> 32;
+  return h;
+}
+
+// wyhash-style mixing for inputs up to HASH_SHORT_MAX bytes, reads overlap instead of branching on the tail
+u64 hash_short(const u8* p, const size_t count, u64 seed) {
+  const u64* s = hash_secret;
+  seed ^= hash_mix(seed ^ s[0], s[1]);
+  u64 a = 0;
+  u64 b = 0;
+  if (count <= 16) {
+    if (count >= 4) {
+      const size_t offset = (count >> 3) << 2;
+      a = (hash_read32(p) << 32) | hash_read32(p + offset);
+      b = (hash_read32(p + count - 4) << 32) | hash_read32(p + count - 4 - offset);
+    }
+    else if (count > 0) {
+      a = ((u64)p[0] << 16) | ((u64)p[count >> 1] << 8) | p[count - 1];
+    }
+  }
+  else {
+    size_t i = count;
+    if (i > 48) {
+      u64 seed1 = seed;
+      u64 seed2 = seed;
+      do {
+        seed  = hash_mix(hash_read64(p)      ^ s[1], hash_read64(p + 8)  ^ seed);
+        seed1 = hash_mix(hash_read64(p + 16) ^ s[2], hash_read64(p + 24) ^ seed1);
+        seed2 = hash_mix(hash_read64(p + 32) ^ s[3], hash_read64(p + 40) ^ seed2);
+        p += 48;
+        i -= 48;
+      } while (i > 48);
+      seed ^= seed1 ^ seed2;
+    }
+    while (i > 16) {
+      seed = hash_mix(hash_read64(p) ^ s[1], hash_read64(p + 8) ^ seed);
+      p += 16;
+      i -= 16;
+    }
+    a = hash_read64(p + i - 16);
+    b = hash_read64(p + i - 8);
+  }
+  a ^= s[1];
+  b ^= seed;
+  hash_mum(&a, &b);
+  return hash_mix(a ^ s[0] ^ count, b ^ s[1]);
+}
+
+void hash_secret_init(u64* secret, const u64 seed) {
+  for (size_t i = 0; i < HASH_SECRET_COUNT; i += 2) {
+    secret[i]     = hash_secret[i] + seed;
+    secret[i + 1] = hash_secret[i + 1] - seed;
+  }
+}
+
+void hash_acc_init(u64* acc) {
+  acc[0] = HASH_PRIME32_3;
+  acc[1] = HASH_PRIME64_1;
+  acc[2] = HASH_PRIME64_2;
+  acc[3] = HASH_PRIME64_3;
+  acc[4] = HASH_PRIME64_4;
+  acc[5] = HASH_PRIME32_2;
+  acc[6] = HASH_PRIME64_5;
+  acc[7] = HASH_PRIME32_1;
+}
+
+// per lane: acc[i] += lo32(data ^ key) * hi32(data ^ key), acc[i ^ 1] += data
+void hash_accumulate(u64* acc, const u8* stripe, const u64* key) {
+#ifdef HASH_USE_SSE2
+  __m128i* a = (__m128i*)acc;
+  for (size_t i = 0; i < HASH_STRIPE_LANES / 2; ++i) {
+    __m128i data = _mm_loadu_si128((const __m128i*)stripe + i);
+    __m128i k = _mm_loadu_si128((const __m128i*)key + i);
+    __m128i data_key = _mm_xor_si128(data, k);
+    __m128i data_key_hi = _mm_shuffle_epi32(data_key, _MM_SHUFFLE(0, 3, 0, 1));
+    __m128i product = _mm_mul_epu32(data_key, data_key_hi);
+    __m128i data_swap = _mm_shuffle_epi32(data, _MM_SHUFFLE(1, 0, 3, 2));
+    __m128i sum = _mm_add_epi64(_mm_loadu_si128(a + i), data_swap);
+    _mm_storeu_si128(a + i, _mm_add_epi64(product, sum));
+  }
+#else
+  for (size_t i = 0; i < HASH_STRIPE_LANES; ++i) {
+    const u64 data = hash_read64(stripe + 8 * i);
+    const u64 data_key = data ^ key[i];
+    acc[i ^ 1] += data;
+    acc[i] += (u64)(u32)data_key * (data_key >> 32);
+  }
+#endif
+}
+
+// per lane: acc = (acc ^ (acc >> 47) ^ key) * PRIME32_1
+void hash_scramble(u64* acc, const u64* key) {
+#ifdef HASH_USE_SSE2
+  __m128i* a = (__m128i*)acc;
+  const __m128i prime = _mm_set1_epi32((i32)HASH_PRIME32_1);
+  for (size_t i = 0; i < HASH_STRIPE_LANES / 2; ++i) {
+    __m128i v = _mm_loadu_si128(a + i);
+    v = _mm_xor_si128(v, _mm_srli_epi64(v, 47));
+    v = _mm_xor_si128(v, _mm_loadu_si128((const __m128i*)key + i));
+    __m128i product_lo = _mm_mul_epu32(v, prime);
+    __m128i product_hi = _mm_mul_epu32(_mm_shuffle_epi32(v, _MM_SHUFFLE(0, 3, 0, 1)), prime);
+    _mm_storeu_si128(a + i, _mm_add_epi64(product_lo, _mm_slli_epi64(product_hi, 32)));
+  }
+#else
+  for (size_t i = 0; i < HASH_STRIPE_LANES; ++i) {
+    u64 v = acc[i];
+    v ^= v >> 47;
+    v ^= key[i];
+    acc[i] = v * HASH_PRIME32_1;
+  }
+#endif
+}
+
+// both the one-shot and the streaming path feed stripes through here, so the block boundaries line up
+void hash_stripes(u64* acc, size_t* stripes, const u8* p, const size_t count, const u64* secret) {
+  for (size_t i = 0; i < count; ++i) {
+    hash_accumulate(acc, p + i * HASH_STRIPE_SIZE, secret + *stripes);
+    if (++*stripes == HASH_BLOCK_STRIPES) {
+      hash_scramble(acc, secret + HASH_SCRAMBLE_KEY);
+      *stripes = 0;
+    }
+  }
+}
+
+u64 hash_long_finish(u64* acc, const u8* last_stripe, const u64* secret, const u64 total) {
+  hash_accumulate(acc, last_stripe, secret + HASH_LAST_KEY);
+  u64 result = total * HASH_PRIME64_1;
+  for (size_t i = 0; i < HASH_STRIPE_LANES; i += 2) {
+    result += hash_mix(acc[i] ^ secret[HASH_MERGE_KEY + i], acc[i + 1] ^ secret[HASH_MERGE_KEY + i + 1]);
+  }
+  return hash_avalanche(result);
+}
+
+// the last stripe always ends at the end of the input and is accumulated separately, overlapping the previous one if needed
+u64 hash_long(const u8* p, const size_t count, const u64* secret) {
+  u64 acc[HASH_STRIPE_LANES];
+  size_t stripes = 0;
+  hash_acc_init(acc);
+  hash_stripes(acc, &stripes, p, (count - 1) / HASH_STRIPE_SIZE, secret);
+  return hash_long_finish(acc, p + count - HASH_STRIPE_SIZE, secret, count);
+}
+
+COMMON_PUBLICDEF
+u64 hash64(const void* data, const size_t count) {
+  if (count <= HASH_SHORT_MAX) {
+    return hash_short((const u8*)data, count, 0);
+  }
+  return hash_long((const u8*)data, count, hash_secret);
+}
+
+COMMON_PUBLICDEF
+u64 hash64_seed(const void* data, const size_t count, const u64 seed) {
+  if (count <= HASH_SHORT_MAX) {
+    return hash_short((const u8*)data, count, seed);
+  }
+  if (seed == 0) {
+    return hash_long((const u8*)data, count, hash_secret);
+  }
+  u64 secret[HASH_SECRET_COUNT];
+  hash_secret_init(secret, seed);
+  return hash_long((const u8*)data, count, secret);
+}
+
+COMMON_PUBLICDEF
+u64 hash_str(const char* str) {
+  return hash64(str, strlen(str));
+}
+
+COMMON_PUBLICDEF
+Hash_state hash_state_new(const u64 seed) {
+  Hash_state state = {
+    .buffered = 0,
+    .stripes = 0,
+    .total = 0,
+    .seed = seed,
+  };
+  hash_acc_init(state.acc);
+  hash_secret_init(state.secret, seed);
+  return state;
+}
+
+// input is held back until it is known not to be the end, so that hash_digest can treat the tail the same way hash64 does
+COMMON_PUBLICDEF
+void hash_update(Hash_state* state, const void* data, const size_t count) {
+  const u8* p = (const u8*)data;
+  size_t remaining = count;
+  state->total += count;
+  if (state->buffered + remaining <= HASH_SHORT_MAX) {
+    memcpy(&state->buffer[state->buffered], p, remaining);
+    state->buffered += remaining;
+    return;
+  }
+  const size_t buffer_stripes = HASH_SHORT_MAX / HASH_STRIPE_SIZE;
+  if (state->buffered > 0) {
+    const size_t fill = HASH_SHORT_MAX - state->buffered;
+    memcpy(&state->buffer[state->buffered], p, fill);
+    p += fill;
+    remaining -= fill;
+    hash_stripes(state->acc, &state->stripes, state->buffer, buffer_stripes, state->secret);
+    state->buffered = 0;
+  }
+  if (remaining > HASH_SHORT_MAX) {
+    do {
+      hash_stripes(state->acc, &state->stripes, p, buffer_stripes, state->secret);
+      p += HASH_SHORT_MAX;
+      remaining -= HASH_SHORT_MAX;
+    } while (remaining > HASH_SHORT_MAX);
+    memcpy(&state->buffer[HASH_SHORT_MAX - HASH_STRIPE_SIZE], p - HASH_STRIPE_SIZE, HASH_STRIPE_SIZE);
+  }
+  memcpy(state->buffer, p, remaining);
+  state->buffered = remaining;
+}
+
+// does not modify the state, more data can be added after taking a digest
+COMMON_PUBLICDEF
+u64 hash_digest(const Hash_state* state) {
+  if (state->total <= HASH_SHORT_MAX) {
+    return hash_short(state->buffer, state->buffered, state->seed);
+  }
+  u64 acc[HASH_STRIPE_LANES];
+  size_t stripes = state->stripes;
+  memcpy(acc, state->acc, sizeof(acc));
+  hash_stripes(acc, &stripes, state->buffer, (state->buffered - 1) / HASH_STRIPE_SIZE, state->secret);
+  if (state->buffered >= HASH_STRIPE_SIZE) {
+    return hash_long_finish(acc, &state->buffer[state->buffered - HASH_STRIPE_SIZE], state->secret, state->total);
+  }
+  u8 last_stripe[HASH_STRIPE_SIZE];
+  const size_t previous = HASH_STRIPE_SIZE - state->buffered;
+  memcpy(last_stripe, &state->buffer[HASH_SHORT_MAX - previous], previous);
+  memcpy(&last_stripe[previous], state->buffer, state->buffered);
+  return hash_long_finish(acc, last_stripe, state->secret, state->total);
+}
+
+#ifdef _BUFFER_H
+
+COMMON_PUBLICDEF
+u64 hash_buffer(const Buffer* buffer) {
+  return hash64(buffer->data, buffer->count);
+}
+
+COMMON_PUBLICDEF
+u64 hash_string_view(const String_view view) {
+  return hash64(view.data, view.count);
+}
+
+#endif
+
+#endif // HASH_IMPLEMENTATION
+#undef HASH_IMPLEMENTATION
@@ -0,0 +1,130 @@
+// pool.h
+// fixed-size object pool on top of an arena
+
+// macros:
+//  POOL_IMPLEMENTATION
+//  POOL_BATCH_COUNT = 64
+
+#ifndef _POOL_H
+#define _POOL_H
+
+#include "arena.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// number of slots that are taken from the arena at a time, so that slots stay close together even if the arena is shared
+#ifndef POOL_BATCH_COUNT
+  #define POOL_BATCH_COUNT 64
+#endif
+
+// free slots hold the link to the next free slot, so there is no per-object header
+typedef struct Pool_slot {
+  struct Pool_slot* next;
+} Pool_slot;
+
+typedef struct Pool {
+  Arena* arena;
+  Pool_slot* free_list;
+  u8* carve;     // next unused slot of the current batch
+  u8* carve_end; // end of the current batch
+  size_t slot_size;
+  size_t align;
+  size_t count;  // number of slots in use
+} Pool;
+
+COMMON_PUBLICDEC Pool pool_new(Arena* arena, const size_t slot_size, const size_t align);
+COMMON_PUBLICDEC void* pool_alloc(Pool* pool);
+COMMON_PUBLICDEC void pool_free(Pool* pool, void* p);
+COMMON_PUBLICDEC void pool_reset(Pool* pool);
+
+#define pool_new_type(ARENA, T) pool_new(ARENA, sizeof(T), ARENA_ALIGNOF(T))
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _POOL_H
+
+#ifdef POOL_IMPLEMENTATION
+
+static bool pool_carve(Pool* pool);
+
+// take a new batch of slots from the arena, fall back to a single slot when the arena can not fit a whole batch
+bool pool_carve(Pool* pool) {
+  size_t count = POOL_BATCH_COUNT;
+  u8* batch = (u8*)arena_alloc_aligned(pool->arena, count * pool->slot_size, pool->align);
+  if (!batch) {
+    count = 1;
+    batch = (u8*)arena_alloc_aligned(pool->arena, pool->slot_size, pool->align);
+    if (!batch) {
+      return false;
+    }
+  }
+  pool->carve = batch;
+  pool->carve_end = batch + count * pool->slot_size;
+  return true;
+}
+
+COMMON_PUBLICDEF
+Pool pool_new(Arena* arena, const size_t slot_size, const size_t align) {
+  ASSERT(arena != NULL);
+  ASSERT(slot_size > 0);
+  size_t slot_align = MAX(align, ARENA_ALIGNOF(Pool_slot));
+  ASSERT((slot_align & (slot_align - 1)) == 0 && "alignment must be a power of two");
+  size_t size = MAX(slot_size, sizeof(Pool_slot));
+  return (Pool) {
+    .arena = arena,
+    .free_list = NULL,
+    .carve = NULL,
+    .carve_end = NULL,
+    .slot_size = ALIGN(size, slot_align),
+    .align = slot_align,
+    .count = 0,
+  };
+}
+
+COMMON_PUBLICDEF
+void* pool_alloc(Pool* pool) {
+  ASSERT(pool != NULL);
+  if (pool->free_list) {
+    Pool_slot* slot = pool->free_list;
+    pool->free_list = slot->next;
+    pool->count += 1;
+    return (void*)slot;
+  }
+  if (pool->carve == pool->carve_end && !pool_carve(pool)) {
+    return NULL;
+  }
+  void* p = (void*)pool->carve;
+  pool->carve += pool->slot_size;
+  pool->count += 1;
+  return p;
+}
+
+COMMON_PUBLICDEF
+void pool_free(Pool* pool, void* p) {
+  ASSERT(pool != NULL);
+  if (!p) {
+    return;
+  }
+  ASSERT(pool->count > 0);
+  Pool_slot* slot = (Pool_slot*)p;
+  slot->next = pool->free_list;
+  pool->free_list = slot;
+  pool->count -= 1;
+}
+
+// forget all slots, to be used together with arena_reset or arena_restore on the arena of the pool
+COMMON_PUBLICDEF
+void pool_reset(Pool* pool) {
+  ASSERT(pool != NULL);
+  pool->free_list = NULL;
+  pool->carve = NULL;
+  pool->carve_end = NULL;
+  pool->count = 0;
+}
+
+#endif // POOL_IMPLEMENTATION
+#undef POOL_IMPLEMENTATION
@@ -0,0 +1,593 @@
+// rope.h
+// balanced rope for large editable text, the leaves are Buffer chunks that are allocated from pools on an arena
+
+// macros:
+//  ROPE_IMPLEMENTATION
+//  ROPE_LEAF_SIZE = Kb(4)
+
+#ifndef _ROPE_H
+#define _ROPE_H
+
+#include "arena.h"
+#include "pool.h"
+#include "buffer.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// bytes in a leaf chunk
+#ifndef ROPE_LEAF_SIZE
+  #define ROPE_LEAF_SIZE Kb(4)
+#endif
+
+// an avl tree of this height holds more leaves than can be addressed
+#define ROPE_MAX_HEIGHT 96
+
+typedef struct Rope_node {
+  struct Rope_node* left;  // both children are NULL for leaves
+  struct Rope_node* right;
+  size_t count;            // bytes in the subtree
+  size_t lines;            // newlines in the subtree
+  u32 height;              // 1 for leaves
+  Buffer leaf;             // text of a leaf, data is a chunk of ROPE_LEAF_SIZE bytes
+} Rope_node;
+
+// ropes that are split from or concatenated with each other must share an allocator
+typedef struct Rope_allocator {
+  Pool nodes;
+  Pool chunks;
+} Rope_allocator;
+
+typedef struct Rope {
+  Rope_allocator* allocator;
+  Rope_node* root;
+} Rope;
+
+// visits the leaves in order
+typedef struct Rope_iterator {
+  Rope_node* stack[ROPE_MAX_HEIGHT];
+  size_t depth;
+} Rope_iterator;
+
+COMMON_PUBLICDEC Rope_allocator rope_allocator_new(Arena* arena);
+COMMON_PUBLICDEC Rope rope_new(Rope_allocator* allocator);
+COMMON_PUBLICDEC Rope rope_new_from_buffer(Rope_allocator* allocator, const Buffer* buffer);
+COMMON_PUBLICDEC size_t rope_count(const Rope* rope);
+COMMON_PUBLICDEC size_t rope_line_count(const Rope* rope);
+COMMON_PUBLICDEC char rope_at(const Rope* rope, size_t index);
+COMMON_PUBLICDEC size_t rope_line_start(const Rope* rope, size_t line);
+COMMON_PUBLICDEC size_t rope_line_of(const Rope* rope, size_t index);
+COMMON_PUBLICDEC void rope_append(Rope* rope, const char* data, size_t count);
+COMMON_PUBLICDEC void rope_insert(Rope* rope, const char* data, size_t count, size_t index);
+COMMON_PUBLICDEC void rope_erase(Rope* rope, size_t index, size_t count);
+COMMON_PUBLICDEC Rope rope_split(Rope* rope, size_t index);
+COMMON_PUBLICDEC void rope_concat(Rope* rope, Rope* other);
+COMMON_PUBLICDEC Rope_iterator rope_iterator_new(const Rope* rope);
+COMMON_PUBLICDEC bool rope_iterator_next(Rope_iterator* it, const char** data, size_t* count);
+COMMON_PUBLICDEC Buffer rope_to_buffer(const Rope* rope);
+COMMON_PUBLICDEC void rope_free(Rope* rope);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _ROPE_H
+
+#ifdef ROPE_IMPLEMENTATION
+
+static size_t rope_count_lines(const char* data, size_t count);
+static u32 rope_height(const Rope_node* node);
+static void rope_update(Rope_node* node);
+static Rope_node* rope_leaf_new(Rope_allocator* allocator, const char* data, size_t count);
+static Rope_node* rope_node_new(Rope_allocator* allocator, Rope_node* left, Rope_node* right);
+static void rope_node_free(Rope_allocator* allocator, Rope_node* node);
+static void rope_tree_free(Rope_allocator* allocator, Rope_node* node);
+static Rope_node* rope_rotate_left(Rope_node* node);
+static Rope_node* rope_rotate_right(Rope_node* node);
+static Rope_node* rope_balance(Rope_node* node);
+static Rope_node* rope_join(Rope_allocator* allocator, Rope_node* left, Rope_node* right);
+static Rope_node* rope_join_merge(Rope_allocator* allocator, Rope_node* left, Rope_node* right);
+static void rope_split_node(Rope_allocator* allocator, Rope_node* node, size_t index, Rope_node** left, Rope_node** right);
+static Rope_node* rope_build(Rope_allocator* allocator, const char* data, size_t count);
+
+size_t rope_count_lines(const char* data, size_t count) {
+  size_t lines = 0;
+  const char* end = data + count;
+  while (data < end && (data = (const char*)memchr(data, '\n', end - data))) {
+    lines += 1;
+    data += 1;
+  }
+  return lines;
+}
+
+u32 rope_height(const Rope_node* node) {
+  return node ? node->height : 0;
+}
+
+void rope_update(Rope_node* node) {
+  if (!node->left) {
+    node->count = node->leaf.count;
+    node->lines = rope_count_lines(node->leaf.data, node->leaf.count);
+    node->height = 1;
+    return;
+  }
+  node->count = node->left->count + node->right->count;
+  node->lines = node->left->lines + node->right->lines;
+  node->height = 1 + MAX(node->left->height, node->right->height);
+}
+
+Rope_node* rope_leaf_new(Rope_allocator* allocator, const char* data, size_t count) {
+  ASSERT(count <= ROPE_LEAF_SIZE);
+  Rope_node* node = (Rope_node*)pool_alloc(&allocator->nodes);
+  char* chunk = (char*)pool_alloc(&allocator->chunks);
+  ASSERT(node != NULL && chunk != NULL);
+  *node = (Rope_node) {
+    .left = NULL,
+    .right = NULL,
+    .count = 0,
+    .lines = 0,
+    .height = 1,
+    .leaf = (Buffer) {
+      .data = chunk,
+      .count = count,
+      .size = ROPE_LEAF_SIZE,
+    },
+  };
+  memcpy(chunk, data, count);
+  rope_update(node);
+  return node;
+}
+
+Rope_node* rope_node_new(Rope_allocator* allocator, Rope_node* left, Rope_node* right) {
+  Rope_node* node = (Rope_node*)pool_alloc(&allocator->nodes);
+  ASSERT(node != NULL);
+  *node = (Rope_node) {
+    .left = left,
+    .right = right,
+    .count = 0,
+    .lines = 0,
+    .height = 0,
+    .leaf = (Buffer) { .data = NULL, .count = 0, .size = 0, },
+  };
+  rope_update(node);
+  return node;
+}
+
+void rope_node_free(Rope_allocator* allocator, Rope_node* node) {
+  if (node->leaf.data) {
+    pool_free(&allocator->chunks, node->leaf.data);
+  }
+  pool_free(&allocator->nodes, node);
+}
+
+void rope_tree_free(Rope_allocator* allocator, Rope_node* node) {
+  if (!node) {
+    return;
+  }
+  rope_tree_free(allocator, node->left);
+  rope_tree_free(allocator, node->right);
+  rope_node_free(allocator, node);
+}
+
+Rope_node* rope_rotate_left(Rope_node* node) {
+  Rope_node* right = node->right;
+  node->right = right->left;
+  rope_update(node);
+  right->left = node;
+  rope_update(right);
+  return right;
+}
+
+Rope_node* rope_rotate_right(Rope_node* node) {
+  Rope_node* left = node->left;
+  node->left = left->right;
+  rope_update(node);
+  left->right = node;
+  rope_update(left);
+  return left;
+}
+
+// restore the avl property of a node whose subtrees differ in height by at most two
+Rope_node* rope_balance(Rope_node* node) {
+  i64 diff = (i64)rope_height(node->left) - (i64)rope_height(node->right);
+  if (diff > 1) {
+    if (rope_height(node->left->left) < rope_height(node->left->right)) {
+      node->left = rope_rotate_left(node->left);
+    }
+    return rope_rotate_right(node);
+  }
+  if (diff < -1) {
+    if (rope_height(node->right->right) < rope_height(node->right->left)) {
+      node->right = rope_rotate_right(node->right);
+    }
+    return rope_rotate_left(node);
+  }
+  return node;
+}
+
+// concatenate two trees, the taller one is descended until the heights are close enough to link them. O(log n)
+Rope_node* rope_join(Rope_allocator* allocator, Rope_node* left, Rope_node* right) {
+  if (!left) {
+    return right;
+  }
+  if (!right) {
+    return left;
+  }
+  if (left->height > right->height + 1) {
+    left->right = rope_join(allocator, left->right, right);
+    rope_update(left);
+    return rope_balance(left);
+  }
+  if (right->height > left->height + 1) {
+    right->left = rope_join(allocator, left, right->left);
+    rope_update(right);
+    return rope_balance(right);
+  }
+  return rope_node_new(allocator, left, right);
+}
+
+// like rope_join, but a single leaf on either side is copied into the neighbouring leaf when it fits, so that
+// repeated edits do not leave behind lots of small leaves
+Rope_node* rope_join_merge(Rope_allocator* allocator, Rope_node* left, Rope_node* right) {
+  if (!left || !right) {
+    return left ? left : right;
+  }
+  if (right->height == 1) {
+    Rope_node* last = left;
+    while (last->right) {
+      last = last->right;
+    }
+    if (last->leaf.count + right->count <= ROPE_LEAF_SIZE) {
+      memcpy(&last->leaf.data[last->leaf.count], right->leaf.data, right->count);
+      last->leaf.count += right->count;
+      for (Rope_node* node = left; node; node = node->right) {
+        node->count += right->count;
+        node->lines += right->lines;
+      }
+      rope_node_free(allocator, right);
+      return left;
+    }
+  }
+  if (left->height == 1) {
+    Rope_node* first = right;
+    while (first->left) {
+      first = first->left;
+    }
+    if (first->leaf.count + left->count <= ROPE_LEAF_SIZE) {
+      memmove(&first->leaf.data[left->count], first->leaf.data, first->leaf.count);
+      memcpy(first->leaf.data, left->leaf.data, left->count);
+      first->leaf.count += left->count;
+      for (Rope_node* node = right; node; node = node->left) {
+        node->count += left->count;
+        node->lines += left->lines;
+      }
+      rope_node_free(allocator, left);
+      return right;
+    }
+  }
+  return rope_join(allocator, left, right);
+}
+
+// split a tree into the bytes before index and the bytes from index on, the internal nodes on the path are
+// released and the pieces are joined back together on the way up
+void rope_split_node(Rope_allocator* allocator, Rope_node* node, size_t index, Rope_node** left, Rope_node** right) {
+  if (!node) {
+    *left = NULL;
+    *right = NULL;
+    return;
+  }
+  if (!node->left) {
+    if (index == 0) {
+      *left = NULL;
+      *right = node;
+    }
+    else if (index >= node->count) {
+      *left = node;
+      *right = NULL;
+    }
+    else {
+      *right = rope_leaf_new(allocator, &node->leaf.data[index], node->count - index);
+      node->leaf.count = index;
+      rope_update(node);
+      *left = node;
+    }
+    return;
+  }
+  Rope_node* node_left = node->left;
+  Rope_node* node_right = node->right;
+  rope_node_free(allocator, node);
+  if (index <= node_left->count) {
+    Rope_node* rest = NULL;
+    rope_split_node(allocator, node_left, index, left, &rest);
+    *right = rope_join(allocator, rest, node_right);
+  }
+  else {
+    Rope_node* rest = NULL;
+    rope_split_node(allocator, node_right, index - node_left->count, &rest, right);
+    *left = rope_join(allocator, node_left, rest);
+  }
+}
+
+// balanced tree of full leaves
+Rope_node* rope_build(Rope_allocator* allocator, const char* data, size_t count) {
+  if (count <= ROPE_LEAF_SIZE) {
+    return count ? rope_leaf_new(allocator, data, count) : NULL;
+  }
+  // split on a leaf boundary so that only the last leaf is partially filled
+  size_t leaf_count = (count + ROPE_LEAF_SIZE - 1) / ROPE_LEAF_SIZE;
+  size_t half = (leaf_count / 2) * ROPE_LEAF_SIZE;
+  Rope_node* left = rope_build(allocator, data, half);
+  Rope_node* right = rope_build(allocator, data + half, count - half);
+  return rope_join(allocator, left, right);
+}
+
+COMMON_PUBLICDEF
+Rope_allocator rope_allocator_new(Arena* arena) {
+  return (Rope_allocator) {
+    .nodes = pool_new_type(arena, Rope_node),
+    .chunks = pool_new(arena, ROPE_LEAF_SIZE, ARENA_DEFAULT_ALIGNMENT),
+  };
+}
+
+COMMON_PUBLICDEF
+Rope rope_new(Rope_allocator* allocator) {
+  ASSERT(allocator != NULL);
+  return (Rope) {
+    .allocator = allocator,
+    .root = NULL,
+  };
+}
+
+COMMON_PUBLICDEF
+Rope rope_new_from_buffer(Rope_allocator* allocator, const Buffer* buffer) {
+  Rope rope = rope_new(allocator);
+  rope.root = rope_build(allocator, buffer->data, buffer->count);
+  return rope;
+}
+
+COMMON_PUBLICDEF
+size_t rope_count(const Rope* rope) {
+  return rope->root ? rope->root->count : 0;
+}
+
+// number of lines, which is one more than the number of newlines
+COMMON_PUBLICDEF
+size_t rope_line_count(const Rope* rope) {
+  return (rope->root ? rope->root->lines : 0) + 1;
+}
+
+COMMON_PUBLICDEF
+char rope_at(const Rope* rope, size_t index) {
+  ASSERT(index < rope_count(rope));
+  Rope_node* node = rope->root;
+  while (node->left) {
+    if (index < node->left->count) {
+      node = node->left;
+    }
+    else {
+      index -= node->left->count;
+      node = node->right;
+    }
+  }
+  return node->leaf.data[index];
+}
+
+// byte index of the first byte of a line, lines are counted from 0
+COMMON_PUBLICDEF
+size_t rope_line_start(const Rope* rope, size_t line) {
+  ASSERT(line < rope_line_count(rope));
+  if (line == 0) {
+    return 0;
+  }
+  // find the newline that ends the line before
+  size_t offset = 0;
+  Rope_node* node = rope->root;
+  while (node->left) {
+    if (line <= node->left->lines) {
+      node = node->left;
+    }
+    else {
+      line -= node->left->lines;
+      offset += node->left->count;
+      node = node->right;
+    }
+  }
+  const char* data = node->leaf.data;
+  for (;;) {
+    const char* newline = (const char*)memchr(data, '\n', node->leaf.data + node->leaf.count - data);
+    ASSERT(newline != NULL);
+    if (--line == 0) {
+      return offset + (newline - node->leaf.data) + 1;
+    }
+    data = newline + 1;
+  }
+}
+
+// line that the byte at index is on
+COMMON_PUBLICDEF
+size_t rope_line_of(const Rope* rope, size_t index) {
+  ASSERT(index <= rope_count(rope));
+  Rope_node* node = rope->root;
+  if (!node) {
+    return 0;
+  }
+  size_t line = 0;
+  while (node->left) {
+    if (index < node->left->count) {
+      node = node->left;
+    }
+    else {
+      line += node->left->lines;
+      index -= node->left->count;
+      node = node->right;
+    }
+  }
+  return line + rope_count_lines(node->leaf.data, index);
+}
+
+COMMON_PUBLICDEF
+void rope_append(Rope* rope, const char* data, size_t count) {
+  rope_insert(rope, data, count, rope_count(rope));
+}
+
+// data must not point into the rope itself
+COMMON_PUBLICDEF
+void rope_insert(Rope* rope, const char* data, size_t count, size_t index) {
+  ASSERT(index <= rope_count(rope));
+  if (count == 0) {
+    return;
+  }
+  // most edits fit into the leaf they land in, which only has to update the counts on the path down
+  Rope_node* node = rope->root;
+  size_t offset = index;
+  while (node && node->left) {
+    if (offset <= node->left->count) {
+      node = node->left;
+    }
+    else {
+      offset -= node->left->count;
+      node = node->right;
+    }
+  }
+  if (node && node->leaf.count + count <= ROPE_LEAF_SIZE) {
+    size_t lines = rope_count_lines(data, count);
+    offset = index;
+    for (node = rope->root; node->left;) {
+      node->count += count;
+      node->lines += lines;
+      if (offset <= node->left->count) {
+        node = node->left;
+      }
+      else {
+        offset -= node->left->count;
+        node = node->right;
+      }
+    }
+    memmove(&node->leaf.data[offset + count], &node->leaf.data[offset], node->leaf.count - offset);
+    memcpy(&node->leaf.data[offset], data, count);
+    node->leaf.count += count;
+    node->count += count;
+    node->lines += lines;
+    return;
+  }
+  Rope_node* left = NULL;
+  Rope_node* right = NULL;
+  rope_split_node(rope->allocator, rope->root, index, &left, &right);
+  Rope_node* middle = rope_build(rope->allocator, data, count);
+  rope->root = rope_join_merge(rope->allocator, rope_join_merge(rope->allocator, left, middle), right);
+}
+
+COMMON_PUBLICDEF
+void rope_erase(Rope* rope, size_t index, size_t count) {
+  ASSERT(index + count <= rope_count(rope));
+  if (count == 0) {
+    return;
+  }
+  Rope_node* node = rope->root;
+  size_t offset = index;
+  while (node->left) {
+    if (offset < node->left->count) {
+      node = node->left;
+    }
+    else {
+      offset -= node->left->count;
+      node = node->right;
+    }
+  }
+  // erasing inside a single leaf that does not become empty
+  if (offset + count < node->leaf.count || (offset > 0 && offset + count == node->leaf.count)) {
+    size_t lines = rope_count_lines(&node->leaf.data[offset], count);
+    offset = index;
+    for (node = rope->root; node->left;) {
+      node->count -= count;
+      node->lines -= lines;
+      if (offset < node->left->count) {
+        node = node->left;
+      }
+      else {
+        offset -= node->left->count;
+        node = node->right;
+      }
+    }
+    memmove(&node->leaf.data[offset], &node->leaf.data[offset + count], node->leaf.count - offset - count);
+    node->leaf.count -= count;
+    node->count -= count;
+    node->lines -= lines;
+    return;
+  }
+  Rope_node* left = NULL;
+  Rope_node* middle = NULL;
+  Rope_node* right = NULL;
+  rope_split_node(rope->allocator, rope->root, index, &left, &right);
+  rope_split_node(rope->allocator, right, count, &middle, &right);
+  rope_tree_free(rope->allocator, middle);
+  rope->root = rope_join_merge(rope->allocator, left, right);
+}
+
+// the bytes from index on are moved into the returned rope
+COMMON_PUBLICDEF
+Rope rope_split(Rope* rope, size_t index) {
+  ASSERT(index <= rope_count(rope));
+  Rope right = rope_new(rope->allocator);
+  rope_split_node(rope->allocator, rope->root, index, &rope->root, &right.root);
+  return right;
+}
+
+// append other to rope, other is left empty
+COMMON_PUBLICDEF
+void rope_concat(Rope* rope, Rope* other) {
+  ASSERT(rope->allocator == other->allocator && "ropes must share an allocator");
+  rope->root = rope_join_merge(rope->allocator, rope->root, other->root);
+  other->root = NULL;
+}
+
+COMMON_PUBLICDEF
+Rope_iterator rope_iterator_new(const Rope* rope) {
+  Rope_iterator it = {0};
+  if (rope->root) {
+    it.stack[it.depth++] = rope->root;
+  }
+  return it;
+}
+
+// get the next chunk of text, returns false when there are no more chunks
+COMMON_PUBLICDEF
+bool rope_iterator_next(Rope_iterator* it, const char** data, size_t* count) {
+  while (it->depth > 0) {
+    Rope_node* node = it->stack[--it->depth];
+    if (!node->left) {
+      *data = node->leaf.data;
+      *count = node->leaf.count;
+      return true;
+    }
+    ASSERT(it->depth + 2 <= ROPE_MAX_HEIGHT);
+    it->stack[it->depth++] = node->right;
+    it->stack[it->depth++] = node->left;
+  }
+  return false;
+}
+
+// copy the text into one null terminated buffer
+COMMON_PUBLICDEF
+Buffer rope_to_buffer(const Rope* rope) {
+  size_t size = rope_count(rope);
+  Buffer buffer = buffer_new(size + 1);
+  Rope_iterator it = rope_iterator_new(rope);
+  const char* data = NULL;
+  size_t count = 0;
+  while (rope_iterator_next(&it, &data, &count)) {
+    memcpy(&buffer.data[buffer.count], data, count);
+    buffer.count += count;
+  }
+  return buffer;
+}
+
+COMMON_PUBLICDEF
+void rope_free(Rope* rope) {
+  rope_tree_free(rope->allocator, rope->root);
+  rope->root = NULL;
+}
+
+#endif // ROPE_IMPLEMENTATION
+#undef ROPE_IMPLEMENTATION
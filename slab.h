@@ -0,0 +1,480 @@
+// slab.h
+// size-class slab allocator with per-thread caches
+
+// macros:
+//  SLAB_IMPLEMENTATION
+//  SLAB_SIZE = Kb(64)
+//  SLAB_BATCH_COUNT = 32
+//
+// slab_install() replaces the allocation hooks of arena.h, buffer.h and wav.h, for the headers that were included before
+// the implementation. it must be called before anything is allocated through those hooks.
+
+#ifndef _SLAB_H
+#define _SLAB_H
+
+#include "thread.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// size of a slab, also its alignment, so the slab of a small object can be found by masking the address
+#ifndef SLAB_SIZE
+  #define SLAB_SIZE Kb(64)
+#endif
+
+// number of objects that move between a thread cache and the shared free lists at a time
+#ifndef SLAB_BATCH_COUNT
+  #define SLAB_BATCH_COUNT 32
+#endif
+
+#define SLAB_HEADER_SIZE 64
+#define SLAB_CLASS_COUNT 20
+#define SLAB_MAX_SIZE 16384
+#define SLAB_MAGIC 0x51ab51ab
+#define SLAB_LARGE_MAGIC 0x1a7e51ab
+
+// the slab map has one bit for every SLAB_SIZE block of the address space, set for the blocks that are slabs. it is split
+// into leaves that each cover 2^SLAB_MAP_LEAF_BITS bytes and are only allocated once a slab lands in their range
+#define SLAB_ADDRESS_BITS 48
+#define SLAB_MAP_LEAF_BITS 36
+#define SLAB_MAP_LEAF_COUNT ((size_t)1 << (SLAB_ADDRESS_BITS - SLAB_MAP_LEAF_BITS))
+#define SLAB_MAP_LEAF_WORDS (((size_t)1 << SLAB_MAP_LEAF_BITS) / SLAB_SIZE / (8 * sizeof(size_t)))
+
+typedef struct Slab_object {
+  struct Slab_object* next;
+} Slab_object;
+
+typedef struct Slab {
+  struct Slab* next; // all slabs of the allocator, for slab_destroy
+  u32 class_index;
+  u32 magic;
+} Slab;
+
+// allocations larger than SLAB_MAX_SIZE come from malloc with this in front, 16 bytes so the alignment of malloc is kept
+typedef struct Slab_large {
+  u64 size;
+  u32 magic;
+  u32 unused;
+} Slab_large;
+
+typedef struct Slab_cache {
+  Slab_object* free[SLAB_CLASS_COUNT];
+  u32 count[SLAB_CLASS_COUNT];
+  bool registered;
+} Slab_cache;
+
+typedef struct Slab_stats {
+  size_t slab_count;        // number of slabs for small allocations
+  size_t large_count;       // number of live large allocations, updated without the lock
+  size_t large_bytes;
+} Slab_stats;
+
+COMMON_PUBLICDEC void* slab_malloc(size_t size);
+COMMON_PUBLICDEC void* slab_calloc(size_t n, size_t size);
+COMMON_PUBLICDEC void* slab_realloc(void* p, size_t size);
+COMMON_PUBLICDEC void slab_free(void* p);
+COMMON_PUBLICDEC size_t slab_usable_size(void* p);
+COMMON_PUBLICDEC void slab_flush(void);
+COMMON_PUBLICDEC void slab_install(void);
+COMMON_PUBLICDEC Slab_stats slab_stats(void);
+COMMON_PUBLICDEC void slab_destroy(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _SLAB_H
+
+#ifdef SLAB_IMPLEMENTATION
+
+static const u32 slab_class_sizes[SLAB_CLASS_COUNT] = {
+  16, 32, 48, 64, 96, 128, 192, 256, 384, 512,
+  768, 1024, 1536, 2048, 3072, 4096, 6144, 8192, 12288, 16384,
+};
+
+static struct {
+  Ticket mutex;
+  Slab_object* free[SLAB_CLASS_COUNT];
+  Slab* slabs;
+  Slab_stats stats;
+} slab_state = {0};
+
+static volatile size_t slab_map[SLAB_MAP_LEAF_COUNT] = {0}; // leaf bitmaps, written under the lock and read without it
+
+static THREAD_LOCAL Slab_cache slab_cache = {0};
+
+static u32 slab_class_index(size_t size);
+static void* slab_system_alloc(size_t size);
+static void slab_system_free(void* p);
+static Slab* slab_from_pointer(void* p);
+static bool slab_map_add(Slab* slab);
+static bool slab_map_get(void* p);
+static bool slab_refill(Slab_cache* cache, u32 class_index);
+static void slab_release(Slab_cache* cache, u32 class_index, u32 count);
+static void slab_cache_register(void);
+static void slab_cache_destroy(void* data);
+static Slab_cache* slab_cache_get(void);
+
+// classes go 16, 32 and then 2^k and 1.5 * 2^k, which keeps internal fragmentation below 33%
+u32 slab_class_index(size_t size) {
+  if (size <= 16) {
+    return 0;
+  }
+  if (size <= 32) {
+    return 1;
+  }
+  u32 k = 63 - __builtin_clzll((u64)(size - 1));
+  if (size <= ((size_t)3 << (k - 1))) {
+    return 2 * (k - 5) + 2;
+  }
+  return 2 * (k - 5) + 3;
+}
+
+// slabs come straight from the system, the hooks may point back at this allocator
+void* slab_system_alloc(size_t size) {
+#if defined(TARGET_WINDOWS)
+  return _aligned_malloc(size, SLAB_SIZE);
+#else
+  void* p = NULL;
+  if (posix_memalign(&p, SLAB_SIZE, size) != 0) {
+    return NULL;
+  }
+  return p;
+#endif
+}
+
+void slab_system_free(void* p) {
+#if defined(TARGET_WINDOWS)
+  _aligned_free(p);
+#else
+  free(p);
+#endif
+}
+
+Slab* slab_from_pointer(void* p) {
+  Slab* slab = (Slab*)((uintptr_t)p & ~((uintptr_t)SLAB_SIZE - 1));
+  ASSERT(slab->magic == SLAB_MAGIC && "pointer was not allocated by slab_malloc");
+  return slab;
+}
+
+// called with the lock held, fails when the slab is outside of the mapped address range or a leaf can not be allocated
+bool slab_map_add(Slab* slab) {
+  u64 address = (u64)(uintptr_t)slab;
+  size_t leaf_index = (size_t)(address >> SLAB_MAP_LEAF_BITS);
+  if (leaf_index >= SLAB_MAP_LEAF_COUNT) {
+    return false;
+  }
+  size_t* leaf = (size_t*)atomic_load(&slab_map[leaf_index]);
+  if (!leaf) {
+    if (!(leaf = (size_t*)calloc(SLAB_MAP_LEAF_WORDS, sizeof(size_t)))) {
+      return false;
+    }
+    atomic_store(&slab_map[leaf_index], (size_t)(uintptr_t)leaf);
+  }
+  size_t block = (size_t)((address & (((u64)1 << SLAB_MAP_LEAF_BITS) - 1)) / SLAB_SIZE);
+  volatile size_t* word = &leaf[block / (8 * sizeof(size_t))];
+  size_t bit = (size_t)1 << (block % (8 * sizeof(size_t)));
+  atomic_store(word, atomic_load(word) | bit);
+  return true;
+}
+
+// whether p points into a slab, if not it is a large allocation
+bool slab_map_get(void* p) {
+  u64 address = (u64)(uintptr_t)p;
+  size_t leaf_index = (size_t)(address >> SLAB_MAP_LEAF_BITS);
+  if (leaf_index >= SLAB_MAP_LEAF_COUNT) {
+    return false;
+  }
+  size_t* leaf = (size_t*)atomic_load(&slab_map[leaf_index]);
+  if (!leaf) {
+    return false;
+  }
+  size_t block = (size_t)((address & (((u64)1 << SLAB_MAP_LEAF_BITS) - 1)) / SLAB_SIZE);
+  size_t word = atomic_load(&leaf[block / (8 * sizeof(size_t))]);
+  return (word >> (block % (8 * sizeof(size_t)))) & 1;
+}
+
+// take a batch of objects from the shared free list, or carve a new slab when it is empty
+bool slab_refill(Slab_cache* cache, u32 class_index) {
+  ticket_mutex_begin(&slab_state.mutex);
+  Slab_object* list = slab_state.free[class_index];
+  if (list) {
+    Slab_object* last = list;
+    u32 count = 1;
+    for (; count < SLAB_BATCH_COUNT && last->next; ++count) {
+      last = last->next;
+    }
+    slab_state.free[class_index] = last->next;
+    ticket_mutex_end(&slab_state.mutex);
+    last->next = cache->free[class_index];
+    cache->free[class_index] = list;
+    cache->count[class_index] += count;
+    return true;
+  }
+  ticket_mutex_end(&slab_state.mutex);
+
+  Slab* slab = (Slab*)slab_system_alloc(SLAB_SIZE);
+  if (!slab) {
+    return false;
+  }
+  slab->class_index = class_index;
+  slab->magic = SLAB_MAGIC;
+  ticket_mutex_begin(&slab_state.mutex);
+  if (!slab_map_add(slab)) {
+    ticket_mutex_end(&slab_state.mutex);
+    slab_system_free(slab);
+    return false;
+  }
+  slab->next = slab_state.slabs;
+  slab_state.slabs = slab;
+  slab_state.stats.slab_count += 1;
+  ticket_mutex_end(&slab_state.mutex);
+
+  size_t object_size = slab_class_sizes[class_index];
+  u32 count = (SLAB_SIZE - SLAB_HEADER_SIZE) / object_size;
+  u8* objects = (u8*)slab + SLAB_HEADER_SIZE;
+  // link the objects in address order, so that the first allocations from a new slab are sequential
+  for (u32 i = 0; i < count; ++i) {
+    Slab_object* object = (Slab_object*)&objects[i * object_size];
+    object->next = (i + 1 < count) ? (Slab_object*)&objects[(i + 1) * object_size] : cache->free[class_index];
+  }
+  cache->free[class_index] = (Slab_object*)objects;
+  cache->count[class_index] += count;
+  return true;
+}
+
+// give count objects of a thread cache back to the shared free list
+void slab_release(Slab_cache* cache, u32 class_index, u32 count) {
+  Slab_object* list = cache->free[class_index];
+  if (!list || count == 0) {
+    return;
+  }
+  Slab_object* last = list;
+  u32 n = 1;
+  for (; n < count && last->next; ++n) {
+    last = last->next;
+  }
+  cache->free[class_index] = last->next;
+  cache->count[class_index] -= n;
+  ticket_mutex_begin(&slab_state.mutex);
+  last->next = slab_state.free[class_index];
+  slab_state.free[class_index] = list;
+  ticket_mutex_end(&slab_state.mutex);
+}
+
+void slab_cache_destroy(void* data) {
+  Slab_cache* cache = (Slab_cache*)data;
+  for (u32 i = 0; i < SLAB_CLASS_COUNT; ++i) {
+    slab_release(cache, i, cache->count[i]);
+  }
+}
+
+#if defined(TARGET_LINUX) || defined(TARGET_APPLE)
+
+static pthread_key_t slab_cache_key;
+static bool slab_cache_key_initialized = false;
+
+// the key is only used for its destructor, which moves the cache of an exiting thread back to the shared free lists
+void slab_cache_register(void) {
+  ticket_mutex_begin(&slab_state.mutex);
+  if (!slab_cache_key_initialized) {
+    pthread_key_create(&slab_cache_key, slab_cache_destroy);
+    slab_cache_key_initialized = true;
+  }
+  ticket_mutex_end(&slab_state.mutex);
+  pthread_setspecific(slab_cache_key, &slab_cache);
+}
+
+#elif defined(TARGET_WINDOWS)
+
+static DWORD slab_cache_key = 0;
+static bool slab_cache_key_initialized = false;
+static VOID WINAPI slab_cache_fls_callback(PVOID data);
+
+VOID WINAPI slab_cache_fls_callback(PVOID data) {
+  slab_cache_destroy(data);
+}
+
+void slab_cache_register(void) {
+  ticket_mutex_begin(&slab_state.mutex);
+  if (!slab_cache_key_initialized) {
+    slab_cache_key = FlsAlloc(slab_cache_fls_callback);
+    slab_cache_key_initialized = true;
+  }
+  ticket_mutex_end(&slab_state.mutex);
+  FlsSetValue(slab_cache_key, &slab_cache);
+}
+
+#endif
+
+// the cache of the calling thread. it is registered for the thread exit destructor before anything is put in it, both
+// by refills and by frees of objects that other threads allocated
+Slab_cache* slab_cache_get(void) {
+  Slab_cache* cache = &slab_cache;
+  if (UNLIKELY(!cache->registered)) {
+    slab_cache_register();
+    cache->registered = true;
+  }
+  return cache;
+}
+
+COMMON_PUBLICDEF
+void* slab_malloc(size_t size) {
+  if (UNLIKELY(size > SLAB_MAX_SIZE)) {
+    if (size > SIZE_MAX - sizeof(Slab_large)) {
+      return NULL;
+    }
+    Slab_large* large = (Slab_large*)malloc(sizeof(Slab_large) + size);
+    if (!large) {
+      return NULL;
+    }
+    large->size = size;
+    large->magic = SLAB_LARGE_MAGIC;
+    atomic_fetch_add(&slab_state.stats.large_count, 1);
+    atomic_fetch_add(&slab_state.stats.large_bytes, size);
+    return large + 1;
+  }
+  u32 class_index = slab_class_index(size);
+  Slab_cache* cache = slab_cache_get();
+  if (UNLIKELY(!cache->free[class_index]) && !slab_refill(cache, class_index)) {
+    return NULL;
+  }
+  Slab_object* object = cache->free[class_index];
+  cache->free[class_index] = object->next;
+  cache->count[class_index] -= 1;
+  return (void*)object;
+}
+
+COMMON_PUBLICDEF
+void* slab_calloc(size_t n, size_t size) {
+  if (size != 0 && n > SIZE_MAX / size) {
+    return NULL;
+  }
+  void* p = slab_malloc(n * size);
+  if (p) {
+    memset(p, 0, n * size);
+  }
+  return p;
+}
+
+COMMON_PUBLICDEF
+void* slab_realloc(void* p, size_t size) {
+  if (!p) {
+    return slab_malloc(size);
+  }
+  size_t old_size = slab_usable_size(p);
+  // stay in place as long as the object is not more than twice as large as it needs to be
+  if (size <= old_size && size > old_size / 2) {
+    return p;
+  }
+  void* new_p = slab_malloc(size);
+  if (!new_p) {
+    return NULL;
+  }
+  memcpy(new_p, p, MIN(old_size, size));
+  slab_free(p);
+  return new_p;
+}
+
+COMMON_PUBLICDEF
+void slab_free(void* p) {
+  if (!p) {
+    return;
+  }
+  if (UNLIKELY(!slab_map_get(p))) {
+    Slab_large* large = (Slab_large*)p - 1;
+    ASSERT(large->magic == SLAB_LARGE_MAGIC && "pointer was not allocated by slab_malloc");
+    atomic_fetch_sub(&slab_state.stats.large_count, 1);
+    atomic_fetch_sub(&slab_state.stats.large_bytes, (size_t)large->size);
+    large->magic = 0;
+    free(large);
+    return;
+  }
+  u32 class_index = slab_from_pointer(p)->class_index;
+  Slab_cache* cache = slab_cache_get();
+  Slab_object* object = (Slab_object*)p;
+  object->next = cache->free[class_index];
+  cache->free[class_index] = object;
+  cache->count[class_index] += 1;
+  if (UNLIKELY(cache->count[class_index] >= 2 * SLAB_BATCH_COUNT)) {
+    slab_release(cache, class_index, SLAB_BATCH_COUNT);
+  }
+}
+
+COMMON_PUBLICDEF
+size_t slab_usable_size(void* p) {
+  if (!slab_map_get(p)) {
+    Slab_large* large = (Slab_large*)p - 1;
+    ASSERT(large->magic == SLAB_LARGE_MAGIC && "pointer was not allocated by slab_malloc");
+    return (size_t)large->size;
+  }
+  return slab_class_sizes[slab_from_pointer(p)->class_index];
+}
+
+// move the cache of the calling thread back to the shared free lists, this happens automatically when a thread exits
+COMMON_PUBLICDEF
+void slab_flush(void) {
+  slab_cache_destroy(&slab_cache);
+}
+
+COMMON_PUBLICDEF
+void slab_install(void) {
+#ifdef _ARENA_H
+  arena_memory_malloc = slab_malloc;
+  arena_memory_calloc = slab_calloc;
+  arena_memory_realloc = slab_realloc;
+  arena_memory_free = slab_free;
+#endif
+#ifdef _BUFFER_H
+  buffer_memory_malloc = slab_malloc;
+  buffer_memory_calloc = slab_calloc;
+  buffer_memory_realloc = slab_realloc;
+  buffer_memory_free = slab_free;
+#endif
+#ifdef _WAV_H
+  wav_memory_malloc = slab_malloc;
+  wav_memory_calloc = slab_calloc;
+  wav_memory_realloc = slab_realloc;
+  wav_memory_free = slab_free;
+#endif
+}
+
+COMMON_PUBLICDEF
+Slab_stats slab_stats(void) {
+  ticket_mutex_begin(&slab_state.mutex);
+  Slab_stats stats = slab_state.stats;
+  ticket_mutex_end(&slab_state.mutex);
+  stats.large_count = atomic_load(&slab_state.stats.large_count);
+  stats.large_bytes = atomic_load(&slab_state.stats.large_bytes);
+  return stats;
+}
+
+// release every slab, only valid when no small allocations are alive and no other thread uses the allocator
+COMMON_PUBLICDEF
+void slab_destroy(void) {
+  for (u32 i = 0; i < SLAB_CLASS_COUNT; ++i) {
+    slab_cache.free[i] = NULL;
+    slab_cache.count[i] = 0;
+  }
+  ticket_mutex_begin(&slab_state.mutex);
+  Slab* slab = slab_state.slabs;
+  while (slab) {
+    Slab* next = slab->next;
+    slab_system_free(slab);
+    slab = next;
+  }
+  slab_state.slabs = NULL;
+  slab_state.stats.slab_count = 0;
+  for (size_t i = 0; i < SLAB_MAP_LEAF_COUNT; ++i) {
+    free((void*)atomic_load(&slab_map[i]));
+    atomic_store(&slab_map[i], 0);
+  }
+  for (u32 i = 0; i < SLAB_CLASS_COUNT; ++i) {
+    slab_state.free[i] = NULL;
+  }
+  ticket_mutex_end(&slab_state.mutex);
+}
+
+#endif // SLAB_IMPLEMENTATION
+#undef SLAB_IMPLEMENTATION
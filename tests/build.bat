@@ -10,16 +10,36 @@ set FLAGS=-Wall -O2 -I.. -DNPROC=%NUMBER_OF_PROCESSORS% -DVERBOSE
 %CC% test_thread_with_mutex.c -o test_thread_with_mutex.exe %LIBS% %INC% %FLAGS%
 %CC% test_thread_sync.c -o test_thread_sync.exe %LIBS% %INC% %FLAGS%
 %CC% test_arena.c -o test_arena.exe %LIBS% %INC% %FLAGS%
+%CC% test_arena_aligned.c -o test_arena_aligned.exe %LIBS% %INC% %FLAGS%
+%CC% test_arena_concurrent.c -o test_arena_concurrent.exe %LIBS% %INC% %FLAGS%
+%CC% test_arena_scratch.c -o test_arena_scratch.exe %LIBS% %INC% %FLAGS%
+%CC% test_arena_stats.c -o test_arena_stats.exe %LIBS% %INC% %FLAGS%
+%CC% test_pool.c -o test_pool.exe %LIBS% %INC% %FLAGS%
+%CC% test_buddy.c -o test_buddy.exe %LIBS% %INC% %FLAGS%
+%CC% test_buffer.c -o test_buffer.exe %LIBS% %INC% %FLAGS%
+%CC% test_slab.c -o test_slab.exe %LIBS% %INC% %FLAGS%
 %CC% test_random.c -o test_random.exe %LIBS% %INC% %FLAGS%
+%CC% test_rope.c -o test_rope.exe %LIBS% %INC% %FLAGS%
 %CC% test_timer.c -o test_timer.exe %LIBS% %INC% %FLAGS%
 %CC% test_log.c -o test_log.exe %LIBS% %INC% %FLAGS%
 %CC% test_glob.c -o test_glob.exe %LIBS% %INC% %FLAGS%
+%CC% test_hash.c -o test_hash.exe %LIBS% %INC% %FLAGS%
 
 test_thread.exe
 test_thread_with_mutex.exe
 test_thread_sync.exe
 test_arena.exe
+test_arena_aligned.exe
+test_arena_concurrent.exe
+test_arena_scratch.exe
+test_arena_stats.exe
+test_pool.exe
+test_buddy.exe
+test_buffer.exe
+test_slab.exe
 test_random.exe
+test_rope.exe
 test_timer.exe
 test_log.exe
 test_glob.exe
+test_hash.exe
@@ -9,9 +9,43 @@
 #include "arena.h"
 
 i32 test(void);
+i32 test_chained(void);
+i32 test_mark(Arena* arena);
+i32 test_virtual(u32 flags);
+i32 test_resize(Arena* arena);
+i32 test_snapshot(void);
+i32 test_ring(void);
 
 i32 main(void) {
-  return test();
+  if (test() != EXIT_SUCCESS) {
+    return EXIT_FAILURE;
+  }
+  if (test_chained() != EXIT_SUCCESS) {
+    return EXIT_FAILURE;
+  }
+  if (test_ring() != EXIT_SUCCESS) {
+    return EXIT_FAILURE;
+  }
+  if (test_snapshot() != EXIT_SUCCESS) {
+    return EXIT_FAILURE;
+  }
+  if (test_virtual(0) != EXIT_SUCCESS || test_virtual(ARENA_HUGE_PAGES) != EXIT_SUCCESS) {
+    return EXIT_FAILURE;
+  }
+  i32 result = EXIT_SUCCESS;
+  Arena arena = arena_new(256);
+  Arena chained = arena_new_chained(16);
+  if (test_mark(&arena) != EXIT_SUCCESS || test_mark(&chained) != EXIT_SUCCESS) {
+    result = EXIT_FAILURE;
+  }
+  arena_reset(&arena);
+  arena_reset(&chained);
+  if (test_resize(&arena) != EXIT_SUCCESS || test_resize(&chained) != EXIT_SUCCESS) {
+    result = EXIT_FAILURE;
+  }
+  arena_free(&arena);
+  arena_free(&chained);
+  return result;
 }
 
 i32 test(void) {
@@ -46,3 +80,251 @@ i32 test(void) {
   arena_free(&arena);
   return result;
 }
+
+i32 test_chained(void) {
+  i32 result = EXIT_SUCCESS;
+  const i32 count = 64;
+  i32* items[64] = {0};
+  Arena arena = arena_new_chained(32);
+  for (i32 i = 0; i < count; ++i) {
+    items[i] = (i32*)arena_alloc(&arena, 4 * sizeof(i32));
+    if (!items[i]) {
+      return_defer(EXIT_FAILURE);
+    }
+    for (i32 j = 0; j < 4; ++j) {
+      items[i][j] = i * j;
+    }
+  }
+  for (i32 i = 0; i < count; ++i) {
+    for (i32 j = 0; j < 4; ++j) {
+      if (items[i][j] != i * j) {
+        return_defer(EXIT_FAILURE);
+      }
+    }
+  }
+  // blocks are kept on reset, so the same allocations should not need any new blocks
+  Arena_block* last = arena.block;
+  arena_reset(&arena);
+  verbose_printf("first block: %zu bytes, last block: %zu bytes\n", arena.blocks->size, last->size);
+  for (i32 i = 0; i < count; ++i) {
+    if (!arena_alloc(&arena, 4 * sizeof(i32))) {
+      return_defer(EXIT_FAILURE);
+    }
+  }
+  if (arena.block != last) {
+    return_defer(EXIT_FAILURE);
+  }
+  // larger than any block so far
+  if (!arena_alloc(&arena, 4 * last->size)) {
+    return_defer(EXIT_FAILURE);
+  }
+defer:
+  arena_free(&arena);
+  return result;
+}
+
+i32 test_mark(Arena* arena) {
+  u8* a = (u8*)arena_alloc(arena, 8);
+  if (!a) {
+    return EXIT_FAILURE;
+  }
+  memset(a, 0xaa, 8);
+  Arena_mark outer = arena_mark(arena);
+  u8* b = (u8*)arena_alloc(arena, 16);
+  Arena_mark inner = arena_mark(arena);
+  for (i32 i = 0; i < 4; ++i) {
+    if (!arena_alloc(arena, 24)) {
+      return EXIT_FAILURE;
+    }
+  }
+  arena_restore(arena, inner);
+  // the next allocation should start where the inner scope began
+  u8* c = (u8*)arena_alloc(arena, 16);
+  verbose_printf("a = %p, b = %p, c = %p\n", (void*)a, (void*)b, (void*)c);
+  if (c != b + 16) {
+    return EXIT_FAILURE;
+  }
+  arena_restore(arena, outer);
+  u8* d = (u8*)arena_alloc(arena, 16);
+  if (d != b) {
+    return EXIT_FAILURE;
+  }
+  // memory from before the outer mark is still live and is not handed out again
+  memset(d, 0x55, 16);
+  for (i32 i = 0; i < 8; ++i) {
+    if (a[i] != 0xaa) {
+      return EXIT_FAILURE;
+    }
+  }
+  return EXIT_SUCCESS;
+}
+
+i32 test_virtual(u32 flags) {
+  i32 result = EXIT_SUCCESS;
+  Arena arena = arena_new_virtual(Gb(1ull), flags);
+  u8* first = (u8*)arena_alloc(&arena, 16);
+  if (!first || arena.size > Mb(2)) {
+    return_defer(EXIT_FAILURE);
+  }
+  // grow in place, pointers handed out earlier must stay valid
+  const size_t chunk = Kb(100);
+  for (size_t i = 0; i < 100; ++i) {
+    u8* p = (u8*)arena_alloc(&arena, chunk);
+    if (!p || p != first + 16 + i * chunk) {
+      return_defer(EXIT_FAILURE);
+    }
+    memset(p, (i32)i, chunk);
+  }
+  verbose_printf("virtual arena: reserved %zu bytes, committed %zu bytes\n", arena.reserved, arena.size);
+  if (arena_alloc(&arena, Gb(2ull)) != NULL) {
+    return_defer(EXIT_FAILURE);
+  }
+  arena_reset(&arena);
+  if (arena.size > MAX(arena.retain, Mb(2))) {
+    return_defer(EXIT_FAILURE);
+  }
+  if (arena_alloc(&arena, 16) != first) {
+    return_defer(EXIT_FAILURE);
+  }
+defer:
+  arena_free(&arena);
+  return result;
+}
+
+// append to an arena-backed dynamic array
+i32 test_resize(Arena* arena) {
+  const i32 count = 40;
+  i32* items = NULL;
+  size_t size = 0;
+  for (i32 i = 0; i < count; ++i) {
+    items = (i32*)arena_resize(arena, items, size * sizeof(i32), (size + 1) * sizeof(i32));
+    if (!items) {
+      return EXIT_FAILURE;
+    }
+    items[size++] = i;
+  }
+  for (i32 i = 0; i < count; ++i) {
+    if (items[i] != i) {
+      return EXIT_FAILURE;
+    }
+  }
+  // as long as the array stays the most recent allocation, it only moves when a chained arena changes blocks
+  if (arena->flags == ARENA_FIXED && (u8*)items + size * sizeof(i32) != &arena->data[arena->index]) {
+    return EXIT_FAILURE;
+  }
+  // shrinking in place gives the memory back
+  size_t index = arena->index;
+  items = (i32*)arena_resize(arena, items, size * sizeof(i32), sizeof(i32));
+  if (arena->index != index - (size - 1) * sizeof(i32) || items[0] != 0) {
+    return EXIT_FAILURE;
+  }
+  // not the most recent allocation any more, so it has to be copied
+  i32* other = (i32*)arena_alloc(arena, sizeof(i32));
+  i32* moved = (i32*)arena_resize(arena, items, sizeof(i32), 2 * sizeof(i32));
+  if (!other || !moved || moved == items || moved[0] != 0) {
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
+
+typedef struct Snapshot_node {
+  Arena_offset next;
+  i32 value;
+} Snapshot_node;
+
+i32 test_snapshot(void) {
+  i32 result = EXIT_SUCCESS;
+  const char* path = "test_arena_snapshot.bin";
+  const i32 count = 1000;
+  Arena arena = arena_new_virtual(Mb(64), 0);
+  Arena loaded = {0};
+  Arena_offset* head = arena_alloc_type(&arena, Arena_offset);
+  arena_offset_set(head, NULL);
+  for (i32 i = 0; i < count; ++i) {
+    Snapshot_node* node = arena_alloc_type(&arena, Snapshot_node);
+    node->value = i;
+    node->next = 0;
+    arena_offset_set(&node->next, arena_offset_get(head));
+    arena_offset_set(head, node);
+  }
+  if (arena_snapshot_save(&arena, path) != Ok) {
+    return_defer(EXIT_FAILURE);
+  }
+  // the third load checks that writes to the copy-on-write mapping did not reach the file
+  for (i32 i = 0; i < 3; ++i) {
+    bool copy_on_write = i == 1;
+    loaded = arena_snapshot_load(path, copy_on_write);
+    if (!loaded.data || loaded.index != arena.index || loaded.data == arena.data) {
+      return_defer(EXIT_FAILURE);
+    }
+    if ((loaded.flags & ARENA_MAPPED) && (uintptr_t)loaded.data % Kb(4) != 0) {
+      return_defer(EXIT_FAILURE);
+    }
+    // the list lives at another address now, but the offsets still work
+    i32 expected = count - 1;
+    for (Snapshot_node* node = (Snapshot_node*)arena_offset_get((Arena_offset*)loaded.data); node; node = (Snapshot_node*)arena_offset_get(&node->next)) {
+      if (node->value != expected--) {
+        return_defer(EXIT_FAILURE);
+      }
+      if (copy_on_write) {
+        node->value = -1;
+      }
+    }
+    if (expected != -1) {
+      return_defer(EXIT_FAILURE);
+    }
+    arena_free(&loaded);
+  }
+  // written with another header size
+  FILE* file = fopen(path, "r+b");
+  if (!file) {
+    return_defer(EXIT_FAILURE);
+  }
+  const u64 header_size = Kb(4);
+  fseek(file, offsetof(Arena_snapshot_header, header_size), SEEK_SET);
+  fwrite(&header_size, sizeof(header_size), 1, file);
+  fclose(file);
+  loaded = arena_snapshot_load(path, false);
+  if (loaded.data) {
+    return_defer(EXIT_FAILURE);
+  }
+defer:
+  if (loaded.data) {
+    arena_free(&loaded);
+  }
+  arena_free(&arena);
+  remove(path);
+  return result;
+}
+
+// every batch reads the output of the batch before it, which must still be intact
+i32 test_ring(void) {
+  i32 result = EXIT_SUCCESS;
+  const size_t batch_size = 100;
+  Arena_ring ring = arena_ring_new(2, 64);
+  i32* previous = NULL;
+  for (i32 batch = 0; batch < 16; ++batch) {
+    i32* items = (i32*)arena_ring_alloc(&ring, batch_size * sizeof(i32));
+    for (size_t i = 0; i < batch_size; ++i) {
+      items[i] = batch * (i32)i + (previous ? previous[i] : 0);
+    }
+    if (previous && arena_ring_previous(&ring, 1)->index == 0) {
+      return_defer(EXIT_FAILURE);
+    }
+    if (previous) {
+      for (size_t i = 0; i < batch_size; ++i) {
+        if (items[i] - previous[i] != batch * (i32)i) {
+          return_defer(EXIT_FAILURE);
+        }
+      }
+    }
+    previous = items;
+    arena_ring_rotate(&ring);
+  }
+  if (ring.frame != 16 || arena_ring_current(&ring)->index != 0) {
+    return_defer(EXIT_FAILURE);
+  }
+defer:
+  arena_ring_free(&ring);
+  return result;
+}
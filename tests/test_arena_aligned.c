@@ -0,0 +1,67 @@
+// test_arena_aligned.c
+
+#include "test_common.h"
+
+#define COMMON_IMPLEMENTATION
+#include "common.h"
+
+#define ARENA_IMPLEMENTATION
+#include "arena.h"
+
+#define IS_ALIGNED(P, ALIGNMENT) (((uintptr_t)(P) & ((ALIGNMENT) - 1)) == 0)
+
+i32 test(Arena* arena);
+
+i32 main(void) {
+  i32 result = EXIT_SUCCESS;
+  Arena arena = arena_new(Kb(4));
+  Arena chained = arena_new_chained(64);
+  if (test(&arena) != EXIT_SUCCESS) {
+    return_defer(EXIT_FAILURE);
+  }
+  if (test(&chained) != EXIT_SUCCESS) {
+    return_defer(EXIT_FAILURE);
+  }
+defer:
+  arena_free(&arena);
+  arena_free(&chained);
+  return result;
+}
+
+i32 test(Arena* arena) {
+  const size_t alignments[] = { 1, 2, 4, 8, 16, 32, 64, 128 };
+  for (size_t round = 0; round < 4; ++round) {
+    for (size_t i = 0; i < LENGTH(alignments); ++i) {
+      // offset the arena by an odd number of bytes before every aligned allocation
+      u8* odd = (u8*)arena_alloc(arena, 3);
+      if (!odd) {
+        return EXIT_FAILURE;
+      }
+      size_t align = alignments[i];
+      u8* p = (u8*)arena_alloc_aligned(arena, 5, align);
+      verbose_printf("align %3zu: %p\n", align, (void*)p);
+      if (!p || !IS_ALIGNED(p, align)) {
+        return EXIT_FAILURE;
+      }
+      // must not overlap with the previous allocation
+      if (p < odd + 3) {
+        return EXIT_FAILURE;
+      }
+      memset(p, 0xff, 5);
+    }
+    f32* samples = arena_alloc_array(arena, f32, 17);
+    if (!samples || !IS_ALIGNED(samples, ARENA_ARRAY_ALIGNMENT)) {
+      return EXIT_FAILURE;
+    }
+    u64* value = arena_alloc_type(arena, u64);
+    if (!value || !IS_ALIGNED(value, ARENA_ALIGNOF(u64))) {
+      return EXIT_FAILURE;
+    }
+    void* line = arena_alloc_cacheline(arena, 1);
+    if (!line || !IS_ALIGNED(line, CACHELINESIZE)) {
+      return EXIT_FAILURE;
+    }
+    arena_reset(arena);
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,152 @@
+// test_arena_concurrent.c
+
+#include "test_common.h"
+
+#define COMMON_IMPLEMENTATION
+#include "common.h"
+
+#define THREAD_IMPLEMENTATION
+#include "thread.h"
+
+#define ARENA_IMPLEMENTATION
+#include "arena.h"
+
+#define THREAD_COUNT NPROC
+#define NUM_WORK_PER_THREAD 4096
+#define ALLOCATION_SIZE 24
+#define ARENA_SIZE (THREAD_COUNT * NUM_WORK_PER_THREAD * 32 + THREAD_COUNT * ARENA_CHUNK_SIZE)
+
+typedef enum Mode {
+  MODE_MUTEX,
+  MODE_ATOMIC,
+  MODE_CHUNK,
+
+  MAX_MODE,
+} Mode;
+
+const char* mode_str[MAX_MODE] = {
+  "mutex",
+  "atomic",
+  "chunk",
+};
+
+typedef struct Shared {
+  Ticket mutex;
+  Arena arena;
+  Arena_concurrent concurrent;
+  Mode mode;
+} Shared;
+
+typedef struct Handle {
+  Shared* shared;
+  u8* items[NUM_WORK_PER_THREAD];
+  u8 value; // written into every allocation of the thread
+  i32 id;
+} Handle;
+
+i32 test(void);
+i32 run(Shared* shared, Handle* handles, size_t thread_count);
+void* work(Handle* handle);
+
+i32 main(void) {
+  return test();
+}
+
+i32 test(void) {
+  thread_init();
+  i32 result = EXIT_SUCCESS;
+  Shared shared = {
+    .mutex = ticket_mutex_new(),
+    .arena = arena_new(ARENA_SIZE),
+    .concurrent = arena_concurrent_new(ARENA_SIZE),
+    .mode = MODE_MUTEX,
+  };
+  Handle* handles = (Handle*)calloc(THREAD_COUNT, sizeof(Handle));
+
+  for (size_t thread_count = 1;; thread_count = MIN(thread_count * 2, THREAD_COUNT)) {
+    for (Mode mode = 0; mode < MAX_MODE; ++mode) {
+      shared.mode = mode;
+      arena_reset(&shared.arena);
+      arena_concurrent_reset(&shared.concurrent);
+      TIMER_START();
+      if (run(&shared, handles, thread_count) != EXIT_SUCCESS) {
+        return_defer(EXIT_FAILURE);
+      }
+      f32 dt = TIMER_END();
+      verbose_printf("%2zu threads, %-6s: %g ms\n", thread_count, mode_str[mode], dt * 1000);
+      (void)dt;
+      // every thread wrote its own id into its allocations, so any overlap shows up here
+      for (size_t i = 0; i < thread_count; ++i) {
+        Handle* handle = &handles[i];
+        for (size_t work_index = 0; work_index < NUM_WORK_PER_THREAD; ++work_index) {
+          u8* item = handle->items[work_index];
+          if (!item || ((uintptr_t)item % ARENA_CONCURRENT_ALIGNMENT && mode != MODE_MUTEX)) {
+            return_defer(EXIT_FAILURE);
+          }
+          for (size_t byte = 0; byte < ALLOCATION_SIZE; ++byte) {
+            if (item[byte] != (u8)i) {
+              return_defer(EXIT_FAILURE);
+            }
+          }
+        }
+      }
+    }
+    break_if(thread_count == THREAD_COUNT);
+  }
+  verbose_printf("done\n");
+defer:
+  free(handles);
+  arena_free(&shared.arena);
+  arena_concurrent_free(&shared.concurrent);
+  return result;
+}
+
+i32 run(Shared* shared, Handle* handles, size_t thread_count) {
+  for (size_t i = 0; i < thread_count; ++i) {
+    Handle* handle = &handles[i];
+    handle->shared = shared;
+    handle->value = (u8)i;
+    handle->id = -1;
+    if ((handle->id = thread_create_v2((void*)work, handle)) < 0) {
+      return EXIT_FAILURE;
+    }
+  }
+  for (size_t i = 0; i < thread_count; ++i) {
+    Handle* handle = &handles[i];
+    ASSERT(handle->id >= 0 && handle->id < MAX_THREADS);
+    thread_join(handle->id);
+    handle->id = -1;
+  }
+  return EXIT_SUCCESS;
+}
+
+void* work(Handle* handle) {
+  Shared* shared = handle->shared;
+  Arena_chunk chunk = arena_chunk_new();
+  for (size_t i = 0; i < NUM_WORK_PER_THREAD; ++i) {
+    u8* item = NULL;
+    switch (shared->mode) {
+      case MODE_MUTEX: {
+        ticket_mutex_begin(&shared->mutex);
+        item = (u8*)arena_alloc(&shared->arena, ALLOCATION_SIZE);
+        ticket_mutex_end(&shared->mutex);
+        break;
+      }
+      case MODE_ATOMIC: {
+        item = (u8*)arena_concurrent_alloc(&shared->concurrent, ALLOCATION_SIZE);
+        break;
+      }
+      case MODE_CHUNK: {
+        item = (u8*)arena_chunk_alloc(&shared->concurrent, &chunk, ALLOCATION_SIZE);
+        break;
+      }
+      default:
+        break;
+    }
+    if (item) {
+      memset(item, handle->value, ALLOCATION_SIZE);
+    }
+    handle->items[i] = item;
+  }
+  return NULL;
+}
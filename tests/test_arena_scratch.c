@@ -0,0 +1,98 @@
+// test_arena_scratch.c
+
+#include "test_common.h"
+
+#define COMMON_IMPLEMENTATION
+#include "common.h"
+
+#define THREAD_IMPLEMENTATION
+#include "thread.h"
+
+#define ARENA_IMPLEMENTATION
+#include "arena.h"
+
+#define THREAD_COUNT (NPROC * 2)
+#define NUM_WORK_PER_THREAD 64
+
+typedef struct Handle {
+  i32 result;
+  i32 id;
+} Handle;
+
+i32 test(void);
+void* work(Handle* handle);
+i32* squares(Arena* arena, i32 count);
+i32 sum_of_squares(i32 count);
+
+i32 main(void) {
+  return test();
+}
+
+i32 test(void) {
+  thread_init();
+  Handle handles[THREAD_COUNT] = {0};
+  for (size_t i = 0; i < THREAD_COUNT; ++i) {
+    Handle* handle = &handles[i];
+    handle->result = EXIT_FAILURE;
+    if ((handle->id = thread_create_v2((void*)work, handle)) < 0) {
+      return EXIT_FAILURE;
+    }
+  }
+  for (size_t i = 0; i < THREAD_COUNT; ++i) {
+    Handle* handle = &handles[i];
+    thread_join(handle->id);
+    if (handle->result != EXIT_SUCCESS) {
+      return EXIT_FAILURE;
+    }
+  }
+  // the main thread has its own scratch arenas as well
+  i32 result = sum_of_squares(100) == 338350 ? EXIT_SUCCESS : EXIT_FAILURE;
+  arena_scratch_free();
+  return result;
+}
+
+void* work(Handle* handle) {
+  handle->result = EXIT_SUCCESS;
+  for (i32 i = 1; i <= NUM_WORK_PER_THREAD; ++i) {
+    i32 expected = (i * (i + 1) * (2 * i + 1)) / 6;
+    if (sum_of_squares(i) != expected) {
+      handle->result = EXIT_FAILURE;
+    }
+  }
+  // nested scratch scopes must not hand out the same arena twice
+  Arena_scratch outer = arena_scratch_begin(NULL);
+  Arena_scratch inner = arena_scratch_begin(outer.arena);
+  if (inner.arena == outer.arena) {
+    handle->result = EXIT_FAILURE;
+  }
+  arena_scratch_end(inner);
+  arena_scratch_end(outer);
+  verbose_printf("thread %2d: done\n", handle->id);
+  return NULL;
+}
+
+// results are allocated in the caller's arena, which may be a scratch arena itself
+i32* squares(Arena* arena, i32 count) {
+  Arena_scratch scratch = arena_scratch_begin(arena);
+  i32* numbers = arena_alloc_array(scratch.arena, i32, count);
+  for (i32 i = 0; i < count; ++i) {
+    numbers[i] = i + 1;
+  }
+  i32* result = arena_alloc_array(arena, i32, count);
+  for (i32 i = 0; i < count; ++i) {
+    result[i] = numbers[i] * numbers[i];
+  }
+  arena_scratch_end(scratch);
+  return result;
+}
+
+i32 sum_of_squares(i32 count) {
+  Arena_scratch scratch = arena_scratch_begin(NULL);
+  i32* values = squares(scratch.arena, count);
+  i32 sum = 0;
+  for (i32 i = 0; i < count; ++i) {
+    sum += values[i];
+  }
+  arena_scratch_end(scratch);
+  return sum;
+}
@@ -0,0 +1,87 @@
+// test_arena_stats.c
+
+#include "test_common.h"
+
+#define COMMON_IMPLEMENTATION
+#include "common.h"
+
+#define LOG_IMPL
+#define ARENA_STATS
+#define ARENA_IMPLEMENTATION
+#include "arena.h"
+
+i32 test(void);
+i32 test_chained(void);
+
+i32 main(void) {
+  if (test() != EXIT_SUCCESS) {
+    return EXIT_FAILURE;
+  }
+  return test_chained();
+}
+
+i32 test(void) {
+  i32 result = EXIT_SUCCESS;
+  Arena arena = arena_new(256);
+  for (i32 i = 0; i < 8; ++i) {
+    if (!arena_alloc(&arena, 16)) {
+      return_defer(EXIT_FAILURE);
+    }
+  }
+  // does not fit in a fixed arena
+  if (arena_alloc(&arena, 256)) {
+    return_defer(EXIT_FAILURE);
+  }
+  arena_reset(&arena);
+  if (!arena_alloc(&arena, 100)) {
+    return_defer(EXIT_FAILURE);
+  }
+  Arena_stats* stats = &arena.stats;
+  if (stats->alloc_count != 9 || stats->failed_count != 1 || stats->reset_count != 1) {
+    return_defer(EXIT_FAILURE);
+  }
+  if (stats->histogram[4] != 8 || stats->histogram[6] != 1 || stats->peak != 128) {
+    return_defer(EXIT_FAILURE);
+  }
+#ifdef VERBOSE
+  arena_stats_print(STDOUT_FILENO, "fixed", &arena);
+#endif
+defer:
+  arena_free(&arena);
+  return result;
+}
+
+// the peak of a chained arena includes the blocks before the current one
+i32 test_chained(void) {
+  i32 result = EXIT_SUCCESS;
+  const i32 count = 64;
+  Arena arena = arena_new_chained(32);
+  for (i32 i = 0; i < count; ++i) {
+    if (!arena_alloc(&arena, 4 * sizeof(i32))) {
+      return_defer(EXIT_FAILURE);
+    }
+  }
+  Arena_block* last = arena.block;
+  arena_reset(&arena);
+  for (i32 i = 0; i < count; ++i) {
+    if (!arena_alloc(&arena, 4 * sizeof(i32))) {
+      return_defer(EXIT_FAILURE);
+    }
+  }
+  if (arena.stats.alloc_count != 2 * count || arena.stats.reset_count != 1 || arena.stats.histogram[4] != 2 * count) {
+    return_defer(EXIT_FAILURE);
+  }
+  // larger than any block so far
+  if (!arena_alloc(&arena, 4 * last->size)) {
+    return_defer(EXIT_FAILURE);
+  }
+  if (arena.stats.peak < 4 * last->size) {
+    return_defer(EXIT_FAILURE);
+  }
+#ifdef VERBOSE
+  arena_stats_print(STDOUT_FILENO, "chained", &arena);
+#endif
+defer:
+  arena_free(&arena);
+  return result;
+}
@@ -0,0 +1,71 @@
+// test_buddy.c
+
+#include "test_common.h"
+
+#define COMMON_IMPLEMENTATION
+#include "common.h"
+
+#define RANDOM_IMPLEMENTATION
+#include "random.h"
+
+#define ARENA_IMPLEMENTATION
+#include "arena.h"
+
+#define BUDDY_IMPLEMENTATION
+#include "buddy.h"
+
+#define ALLOCATION_COUNT 512
+
+i32 test(void);
+
+i32 main(void) {
+  return test();
+}
+
+i32 test(void) {
+  i32 result = EXIT_SUCCESS;
+  random_init(1234);
+  Buddy buddy = buddy_new(Mb(1) - 100);
+  u8* items[ALLOCATION_COUNT] = {0};
+  size_t sizes[ALLOCATION_COUNT] = {0};
+  if (buddy.size != Mb(1) || buddy_alloc(&buddy, Mb(2)) != NULL) {
+    return_defer(EXIT_FAILURE);
+  }
+  for (i32 round = 0; round < 4; ++round) {
+    for (size_t i = 0; i < ALLOCATION_COUNT; ++i) {
+      sizes[i] = 1 + random_number() % 1500;
+      items[i] = (u8*)buddy_alloc(&buddy, sizes[i]);
+      if (!items[i] || buddy_block_size(&buddy, items[i]) < sizes[i]) {
+        return_defer(EXIT_FAILURE);
+      }
+      memset(items[i], (u8)i, sizes[i]);
+    }
+    // free every other block, which leaves the free memory split up
+    for (size_t i = 0; i < ALLOCATION_COUNT; i += 2) {
+      buddy_free(&buddy, items[i]);
+      items[i] = NULL;
+    }
+    Buddy_stats stats = buddy_stats(&buddy);
+    verbose_printf("used %zu, free %zu, largest free %zu, fragmentation %.2f\n", stats.used, stats.free, stats.largest_free, stats.fragmentation);
+    if (stats.used + stats.free != buddy.size || stats.fragmentation <= 0.0f) {
+      return_defer(EXIT_FAILURE);
+    }
+    for (size_t i = 1; i < ALLOCATION_COUNT; i += 2) {
+      for (size_t j = 0; j < sizes[i]; ++j) {
+        if (items[i][j] != (u8)i) {
+          return_defer(EXIT_FAILURE);
+        }
+      }
+      buddy_free(&buddy, items[i]);
+      items[i] = NULL;
+    }
+    // everything is free again, so all blocks must have been merged back into one
+    stats = buddy_stats(&buddy);
+    if (stats.used != 0 || stats.free_blocks != 1 || stats.largest_free != buddy.size) {
+      return_defer(EXIT_FAILURE);
+    }
+  }
+defer:
+  buddy_destroy(&buddy);
+  return result;
+}
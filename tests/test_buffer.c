@@ -0,0 +1,596 @@
+// test_buffer.c
+
+#include "test_common.h"
+
+#define COMMON_IMPLEMENTATION
+#include "common.h"
+
+#define THREAD_IMPLEMENTATION
+#include "thread.h"
+
+#define BUFFER_IMPL
+#include "buffer.h"
+
+#ifdef TARGET_WINDOWS
+  #include <direct.h> // _mkdir, _rmdir
+#else
+  #include <sys/stat.h> // mkdir
+#endif
+
+#define LINE_COUNT 10000
+#define MAPPED_PATH "test_buffer_mapped.txt"
+#define FILES_PATH "test_buffer_files"
+#define FILE_COUNT 150
+
+i32 test(void);
+i32 test_mapped(void);
+i32 test_reader(void);
+i32 test_gap(void);
+i32 test_writer(void);
+i32 test_appendf(void);
+i32 test_files(void);
+i32 test_search(void);
+i32 test_string_view(void);
+i32 make_pipe(i32* fds);
+i32 make_directory(const char* path);
+i32 remove_directory(const char* path);
+
+i32 main(void) {
+  return test();
+}
+
+// large enough for everything the tests write before they start reading
+i32 make_pipe(i32* fds) {
+#ifdef TARGET_WINDOWS
+  return _pipe(fds, Kb(64), _O_BINARY);
+#else
+  return pipe(fds);
+#endif
+}
+
+i32 make_directory(const char* path) {
+#ifdef TARGET_WINDOWS
+  return _mkdir(path);
+#else
+  return mkdir(path, 0755);
+#endif
+}
+
+i32 remove_directory(const char* path) {
+#ifdef TARGET_WINDOWS
+  return _rmdir(path);
+#else
+  return rmdir(path);
+#endif
+}
+
+i32 test(void) {
+  i32 result = EXIT_SUCCESS;
+  Buffer buffer = buffer_new(0);
+  Buffer expected = buffer_new(0);
+  const char* line = "0123456789abcdef\n";
+  size_t length = strlen(line);
+  for (i32 i = 0; i < LINE_COUNT; ++i) {
+    buffer_append_str(&buffer, line);
+    for (size_t n = 0; n < length; ++n) {
+      buffer_append(&expected, line[n]);
+    }
+  }
+  verbose_printf("count: %zu, size: %zu\n", buffer.count, buffer.size);
+  if (buffer.count != LINE_COUNT * length || buffer.count != expected.count || buffer.data[buffer.count] != 0) {
+    return_defer(EXIT_FAILURE);
+  }
+  if (memcmp(buffer.data, expected.data, buffer.count) != 0) {
+    return_defer(EXIT_FAILURE);
+  }
+
+  buffer_reset(&buffer);
+  buffer_append_str(&buffer, "hello world");
+  buffer_insert_n(&buffer, ", dear", 6, 5);
+  buffer_insert_n(&buffer, ">> ", 3, 0);
+  buffer_insert_n(&buffer, "!", 1, buffer.count);
+  buffer_insert(&buffer, '<', buffer.count);
+  if (strcmp(buffer.data, ">> hello, dear world!<") != 0) {
+    return_defer(EXIT_FAILURE);
+  }
+
+  size_t size = buffer.size;
+  buffer_reserve(&buffer, size * 4);
+  if (buffer.size != size * 4 || strcmp(buffer.data, ">> hello, dear world!<") != 0) {
+    return_defer(EXIT_FAILURE);
+  }
+  buffer_reserve(&buffer, 1);
+  if (buffer.size != size * 4) {
+    return_defer(EXIT_FAILURE);
+  }
+  if (test_mapped() != EXIT_SUCCESS) {
+    return_defer(EXIT_FAILURE);
+  }
+  if (test_reader() != EXIT_SUCCESS) {
+    return_defer(EXIT_FAILURE);
+  }
+  if (test_gap() != EXIT_SUCCESS) {
+    return_defer(EXIT_FAILURE);
+  }
+  if (test_writer() != EXIT_SUCCESS) {
+    return_defer(EXIT_FAILURE);
+  }
+  if (test_appendf() != EXIT_SUCCESS) {
+    return_defer(EXIT_FAILURE);
+  }
+  if (test_files() != EXIT_SUCCESS) {
+    return_defer(EXIT_FAILURE);
+  }
+  if (test_search() != EXIT_SUCCESS) {
+    return_defer(EXIT_FAILURE);
+  }
+  if (test_string_view() != EXIT_SUCCESS) {
+    return_defer(EXIT_FAILURE);
+  }
+defer:
+  buffer_free(&buffer);
+  buffer_free(&expected);
+  return result;
+}
+
+// the mapped and the copied contents of a file should match
+i32 test_mapped(void) {
+  i32 result = EXIT_SUCCESS;
+  Buffer source = buffer_new(0);
+  for (i32 i = 0; i < LINE_COUNT; ++i) {
+    buffer_append_str(&source, "line of text\n");
+  }
+  Buffer copied = {0};
+  Buffer mapped = {0};
+  i32 fd = open(MAPPED_PATH, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) {
+    return_defer(EXIT_FAILURE);
+  }
+  ssize_t written = write(fd, source.data, source.count);
+  close(fd);
+  if (written != (ssize_t)source.count) {
+    return_defer(EXIT_FAILURE);
+  }
+  copied = buffer_new_from_file(MAPPED_PATH);
+  mapped = buffer_new_from_file_mapped(MAPPED_PATH, BUFFER_ADVICE_SEQUENTIAL);
+  verbose_printf("mapped %zu bytes\n", mapped.count);
+  if (!mapped.data || mapped.count != source.count || copied.count != source.count) {
+    return_defer(EXIT_FAILURE);
+  }
+  if (memcmp(mapped.data, source.data, source.count) != 0 || memcmp(copied.data, source.data, source.count) != 0) {
+    return_defer(EXIT_FAILURE);
+  }
+defer:
+  buffer_free_mapped(&mapped);
+  buffer_free(&copied);
+  buffer_free(&source);
+  remove(MAPPED_PATH);
+  return result;
+}
+
+// read lines from a pipe through a window that is smaller than most of the lines
+i32 test_reader(void) {
+  i32 result = EXIT_SUCCESS;
+  const size_t line_count = 200;
+  i32 fds[2] = {-1, -1};
+  Buffer line = buffer_new(0);
+  Buffer_reader reader = buffer_reader_new(-1, 16);
+  if (make_pipe(fds) != 0) {
+    return_defer(EXIT_FAILURE);
+  }
+  // line i is i 'x's followed by a newline, the total stays below the capacity of the pipe
+  for (size_t i = 0; i < line_count; ++i) {
+    buffer_reset(&line);
+    for (size_t n = 0; n < i; ++n) {
+      buffer_append(&line, 'x');
+    }
+    buffer_append(&line, '\n');
+    if (write(fds[1], line.data, line.count) != (ssize_t)line.count) {
+      return_defer(EXIT_FAILURE);
+    }
+  }
+  close(fds[1]);
+  fds[1] = -1;
+  reader.fd = fds[0];
+
+  const char* data = NULL;
+  if (buffer_reader_peek(&reader, &data, 4) != 4 || memcmp(data, "\nx\nx", 4) != 0) {
+    return_defer(EXIT_FAILURE);
+  }
+  for (size_t i = 0; i < line_count; ++i) {
+    buffer_reset(&line);
+    if (buffer_reader_read_until(&reader, '\n', &line) != i + 1 || line.data[i] != '\n') {
+      return_defer(EXIT_FAILURE);
+    }
+    for (size_t n = 0; n < i; ++n) {
+      if (line.data[n] != 'x') {
+        return_defer(EXIT_FAILURE);
+      }
+    }
+  }
+  buffer_reset(&line);
+  if (buffer_reader_read_until(&reader, '\n', &line) != 0 || !reader.eof || reader.error) {
+    return_defer(EXIT_FAILURE);
+  }
+  verbose_printf("read %zu lines from a pipe\n", line_count);
+defer:
+  if (fds[0] >= 0) {
+    close(fds[0]);
+  }
+  if (fds[1] >= 0) {
+    close(fds[1]);
+  }
+  buffer_reader_free(&reader);
+  buffer_free(&line);
+  return result;
+}
+
+// the same random edits on a gap buffer and on a plain buffer should give the same text
+i32 test_gap(void) {
+  i32 result = EXIT_SUCCESS;
+  Gap_buffer gap = gap_buffer_new(0);
+  Buffer plain = buffer_new(0);
+  Buffer copy = {0};
+  u32 state = 1234;
+  size_t cursor = 0;
+  for (i32 i = 0; i < 20000; ++i) {
+    state = state * 1664525u + 1013904223u;
+    u32 r = state >> 16;
+    size_t count = gap_buffer_count(&gap);
+    // the cursor mostly stays close to where it was, like in an editor
+    if (r % 16 == 0) {
+      cursor = count ? (r >> 4) % (count + 1) : 0;
+    }
+    if (r % 4 == 0 && cursor > 0) {
+      cursor -= 1;
+      gap_buffer_erase(&gap, cursor);
+      buffer_erase(&plain, cursor);
+    }
+    else {
+      char byte = 'a' + (r >> 8) % 26;
+      gap_buffer_insert(&gap, byte, cursor);
+      buffer_insert(&plain, byte, cursor);
+      cursor += 1;
+    }
+  }
+  gap_buffer_append_n(&gap, "end", 3);
+  buffer_append_str(&plain, "end");
+  gap_buffer_erase_n(&gap, 0, 2);
+  buffer_erase(&plain, 0);
+  buffer_erase(&plain, 0);
+  verbose_printf("gap buffer: %zu bytes, %zu allocated\n", gap_buffer_count(&gap), gap.size);
+  if (gap_buffer_count(&gap) != plain.count) {
+    return_defer(EXIT_FAILURE);
+  }
+  for (size_t i = 0; i < plain.count; i += 97) {
+    if (gap_buffer_at(&gap, i) != plain.data[i]) {
+      return_defer(EXIT_FAILURE);
+    }
+  }
+  copy = gap_buffer_to_buffer(&gap);
+  if (copy.count != plain.count || memcmp(copy.data, plain.data, plain.count) != 0) {
+    return_defer(EXIT_FAILURE);
+  }
+  if (strcmp(gap_buffer_view(&gap), plain.data) != 0) {
+    return_defer(EXIT_FAILURE);
+  }
+defer:
+  gap_buffer_free(&gap);
+  buffer_free(&plain);
+  buffer_free(&copy);
+  return result;
+}
+
+// output goes through a pipe and is read back with a Buffer_reader
+i32 test_writer(void) {
+  i32 result = EXIT_SUCCESS;
+  i32 fds[2] = {-1, -1};
+  Buffer expected = buffer_new(0);
+  Buffer_writer writer = buffer_writer_new(-1, 64, 0);
+  Buffer_reader reader = buffer_reader_new(-1, 0);
+  char large[200] = {0};
+  memset(large, 'L', sizeof(large));
+  if (make_pipe(fds) != 0) {
+    return_defer(EXIT_FAILURE);
+  }
+  writer.fd = fds[1];
+  reader.fd = fds[0];
+  for (i32 i = 0; i < 100; ++i) {
+    if (buffer_writer_write_str(&writer, "word ") != Ok) {
+      return_defer(EXIT_FAILURE);
+    }
+    buffer_append_str(&expected, "word ");
+    if (writer.buffer.count >= writer.threshold) {
+      return_defer(EXIT_FAILURE);
+    }
+    // larger than the threshold, written together with what is buffered
+    if (i % 10 == 0) {
+      if (buffer_writer_write(&writer, large, sizeof(large)) != Ok || writer.buffer.count != 0) {
+        return_defer(EXIT_FAILURE);
+      }
+      buffer_append_n(&expected, large, sizeof(large));
+    }
+  }
+  // nothing is flushed on newlines unless asked for
+  buffer_writer_write_str(&writer, "\n");
+  buffer_append_str(&expected, "\n");
+  if (writer.buffer.count == 0) {
+    return_defer(EXIT_FAILURE);
+  }
+  buffer_writer_flush(&writer);
+  writer.flags = BUFFER_WRITER_LINE;
+  buffer_writer_write_str(&writer, "line\n");
+  buffer_append_str(&expected, "line\n");
+  if (writer.buffer.count != 0) {
+    return_defer(EXIT_FAILURE);
+  }
+  buffer_writer_write_str(&writer, "end");
+  buffer_append_str(&expected, "end");
+  buffer_writer_free(&writer);
+  close(fds[1]);
+  fds[1] = -1;
+
+  char* data = (char*)malloc(expected.count + 1);
+  size_t count = buffer_reader_read(&reader, data, expected.count + 1);
+  i32 same = count == expected.count && memcmp(data, expected.data, count) == 0;
+  free(data);
+  if (!same) {
+    return_defer(EXIT_FAILURE);
+  }
+defer:
+  if (fds[0] >= 0) {
+    close(fds[0]);
+  }
+  if (fds[1] >= 0) {
+    close(fds[1]);
+  }
+  buffer_writer_free(&writer);
+  buffer_reader_free(&reader);
+  buffer_free(&expected);
+  return result;
+}
+
+// formatted output that is much larger than a single stb_sprintf chunk
+i32 test_appendf(void) {
+  i32 result = EXIT_SUCCESS;
+  Buffer buffer = buffer_new(0);
+  Buffer expected = buffer_new(0);
+  char line[64] = {0};
+  for (i32 i = 0; i < 1000; ++i) {
+    size_t count = buffer_appendf(&buffer, "%d: %s %.2f\n", i, "item", i * 0.5);
+    i32 n = snprintf(line, sizeof(line), "%d: %s %.2f\n", i, "item", i * 0.5);
+    buffer_append_n(&expected, line, n);
+    if (count != (size_t)n) {
+      return_defer(EXIT_FAILURE);
+    }
+  }
+  // a single argument that spans several chunks
+  char* long_str = (char*)malloc(5000);
+  memset(long_str, 'z', 4999);
+  long_str[4999] = 0;
+  buffer_appendf(&buffer, "[%s]", long_str);
+  buffer_append(&expected, '[');
+  buffer_append_str(&expected, long_str);
+  buffer_append(&expected, ']');
+  free(long_str);
+  verbose_printf("appendf: %zu bytes\n", buffer.count);
+  if (buffer.count != expected.count || strcmp(buffer.data, expected.data) != 0) {
+    return_defer(EXIT_FAILURE);
+  }
+defer:
+  buffer_free(&buffer);
+  buffer_free(&expected);
+  return result;
+}
+
+// load a directory of files, once with io_uring (where there is io_uring) and once with the thread pool
+i32 test_files(void) {
+  i32 result = EXIT_SUCCESS;
+  char paths[FILE_COUNT][64] = {0};
+  const char* path_list[FILE_COUNT + 1] = {0};
+  char data[5000] = {0};
+  Buffer* buffers = NULL;
+  size_t buffer_count = 0;
+  thread_init();
+  make_directory(FILES_PATH);
+  for (size_t i = 0; i < FILE_COUNT; ++i) {
+    snprintf(paths[i], sizeof(paths[i]), FILES_PATH "/%zu.txt", i);
+    path_list[i] = paths[i];
+    i32 fd = open(paths[i], O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+      return_defer(EXIT_FAILURE);
+    }
+    size_t size = (i * 37) % sizeof(data);
+    memset(data, 'a' + i % 26, size);
+    ssize_t written = write(fd, data, size);
+    close(fd);
+    if (written != (ssize_t)size) {
+      return_defer(EXIT_FAILURE);
+    }
+  }
+  path_list[FILE_COUNT] = FILES_PATH "/missing.txt";
+  for (i32 use_io_uring = 1; use_io_uring >= 0; --use_io_uring) {
+    buffer_files_io_uring = use_io_uring;
+    buffers = buffer_new_from_files(path_list, FILE_COUNT + 1);
+    buffer_count = FILE_COUNT + 1;
+    for (size_t i = 0; i < FILE_COUNT; ++i) {
+      size_t size = (i * 37) % sizeof(data);
+      if (buffers[i].count != size || (size && buffers[i].data[size - 1] != 'a' + (char)(i % 26))) {
+        return_defer(EXIT_FAILURE);
+      }
+    }
+    if (buffers[FILE_COUNT].data != NULL || buffers[FILE_COUNT].count != 0) {
+      return_defer(EXIT_FAILURE);
+    }
+    buffer_free_files(buffers, buffer_count);
+    buffers = NULL;
+  }
+#ifdef TARGET_LINUX
+  // proc files report a size of 0, io_uring reads them until a short read
+  const char* proc_path = "/proc/self/status";
+  buffer_files_io_uring = true;
+  buffers = buffer_new_from_files(&proc_path, 1);
+  buffer_count = 1;
+  if (buffers[0].count == 0) {
+    return_defer(EXIT_FAILURE);
+  }
+  buffer_free_files(buffers, buffer_count);
+  buffers = NULL;
+#endif
+  verbose_printf("loaded %d files\n", FILE_COUNT);
+defer:
+  buffer_free_files(buffers, buffer_count);
+  buffer_files_io_uring = true;
+  for (size_t i = 0; i < FILE_COUNT; ++i) {
+    remove(paths[i]);
+  }
+  remove_directory(FILES_PATH);
+  return result;
+}
+
+// the vectorized searches should agree with plain loops, for every start position and across block boundaries
+i32 test_search(void) {
+  i32 result = EXIT_SUCCESS;
+  Buffer buffer = buffer_new(0);
+  Buffer_lines lines = {0};
+  u32 state = 99;
+  // long enough for the newline count to go past the 255 blocks that fit in its lane counters
+  for (size_t i = 0; i < 10000; ++i) {
+    state = state * 1664525u + 1013904223u;
+    u32 r = (state >> 16) % 64;
+    buffer_append(&buffer, r == 0 ? '\n' : r == 1 ? ',' : r == 2 ? ';' : r == 3 ? (char)0xff : (char)('a' + r % 26));
+  }
+  const char set[] = { ',', ';', (char)0xff };
+  const char large_set[] = "0123456789,;";
+  size_t newlines = 0;
+  for (size_t i = 0; i < buffer.count; ++i) {
+    newlines += buffer.data[i] == '\n';
+  }
+  if (buffer_count_byte(&buffer, '\n') != newlines) {
+    return_defer(EXIT_FAILURE);
+  }
+  // nothing matches an empty set
+  if (buffer_find_any(&buffer, 0, "", 0) != BUFFER_NOT_FOUND) {
+    return_defer(EXIT_FAILURE);
+  }
+  for (size_t start = 0; start <= buffer.count; ++start) {
+    size_t byte = BUFFER_NOT_FOUND;
+    size_t any = BUFFER_NOT_FOUND;
+    size_t large = BUFFER_NOT_FOUND;
+    for (size_t i = start; i < buffer.count; ++i) {
+      char c = buffer.data[i];
+      if (byte == BUFFER_NOT_FOUND && c == (char)0xff) {
+        byte = i;
+      }
+      if (any == BUFFER_NOT_FOUND && (c == ',' || c == ';' || c == (char)0xff)) {
+        any = i;
+      }
+      if (large == BUFFER_NOT_FOUND && (c == ',' || c == ';')) {
+        large = i;
+      }
+      break_if(byte != BUFFER_NOT_FOUND && any != BUFFER_NOT_FOUND && large != BUFFER_NOT_FOUND);
+    }
+    if (buffer_find_byte(&buffer, start, (char)0xff) != byte ||
+      buffer_find_any(&buffer, start, set, sizeof(set)) != any ||
+      buffer_find_any(&buffer, start, large_set, strlen(large_set)) != large) {
+      return_defer(EXIT_FAILURE);
+    }
+  }
+  lines = buffer_lines_new(&buffer);
+  verbose_printf("%zu lines\n", lines.count);
+  if (lines.count != newlines + 1) {
+    return_defer(EXIT_FAILURE);
+  }
+  size_t line = 0;
+  size_t line_start = 0;
+  for (size_t i = 0; i <= buffer.count; ++i) {
+    if (i < buffer.count && buffer.data[i] != '\n') {
+      continue;
+    }
+    size_t length = 0;
+    const char* text = buffer_line(&buffer, &lines, line, &length);
+    if (text != &buffer.data[line_start] || length != i - line_start) {
+      return_defer(EXIT_FAILURE);
+    }
+    line += 1;
+    line_start = i + 1;
+  }
+defer:
+  buffer_lines_free(&lines);
+  buffer_free(&buffer);
+  return result;
+}
+
+// parse a small config without copying anything until the end
+i32 test_string_view(void) {
+  i32 result = EXIT_SUCCESS;
+  Buffer buffer = buffer_new(0);
+  Buffer copy = {0};
+  buffer_append_str(&buffer, "  name = common.h  \n# comment\nsizes=  16, 32,,64 \n\nmode=fast");
+  String_view text = string_view_from_buffer(&buffer);
+  String_view keys[4] = {0};
+  String_view values[4] = {0};
+  size_t count = 0;
+  while (text.count > 0) {
+    String_view line = string_view_trim(string_view_split(&text, '\n'));
+    continue_if(line.count == 0 || string_view_starts_with(line, string_view_from_str("#")));
+    if (count >= LENGTH(keys)) {
+      return_defer(EXIT_FAILURE);
+    }
+    keys[count] = string_view_trim(string_view_split(&line, '='));
+    values[count] = string_view_trim(line);
+    verbose_printf("'" SV_FMT "' = '" SV_FMT "'\n", SV_ARG(keys[count]), SV_ARG(values[count]));
+    count += 1;
+  }
+  if (count != 3 ||
+    !string_view_equal(keys[0], string_view_from_str("name")) ||
+    !string_view_equal(values[0], string_view_from_str("common.h")) ||
+    !string_view_equal(keys[2], string_view_from_str("mode")) ||
+    !string_view_equal(values[2], string_view_from_str("fast"))) {
+    return_defer(EXIT_FAILURE);
+  }
+  // views point into the buffer instead of owning a copy
+  if (values[0].data < buffer.data || values[0].data >= buffer.data + buffer.count) {
+    return_defer(EXIT_FAILURE);
+  }
+
+  String_view sizes = values[1];
+  String_view token = {0};
+  const char* expected[] = { "16", "32", "64" };
+  size_t token_count = 0;
+  while (string_view_token(&sizes, ", ", &token)) {
+    if (token_count >= LENGTH(expected) || !string_view_equal(token, string_view_from_str(expected[token_count]))) {
+      return_defer(EXIT_FAILURE);
+    }
+    token_count += 1;
+  }
+  if (token_count != LENGTH(expected)) {
+    return_defer(EXIT_FAILURE);
+  }
+  // without delimiters the rest of the view is a single token
+  String_view rest = string_view_from_str("no delimiters, here");
+  if (!string_view_token(&rest, "", &token) || token.count != 19 || rest.count != 0 || string_view_token(&rest, "", &token)) {
+    return_defer(EXIT_FAILURE);
+  }
+
+  String_view haystack = string_view_from_str("abababcabc");
+  if (string_view_find(haystack, string_view_from_str("abc")) != 4 ||
+    string_view_find(haystack, string_view_from_str("abcd")) != BUFFER_NOT_FOUND ||
+    string_view_find(haystack, string_view_from_str("c")) != 6 ||
+    string_view_find(string_view_slice(haystack, 5, 100), string_view_from_str("abc")) != 2) {
+    return_defer(EXIT_FAILURE);
+  }
+  if (string_view_compare(string_view_from_str("abc"), string_view_from_str("abd")) >= 0 ||
+    string_view_compare(string_view_from_str("ab"), string_view_from_str("abc")) >= 0 ||
+    string_view_compare(string_view_from_str("abc"), string_view_from_str("abc")) != 0) {
+    return_defer(EXIT_FAILURE);
+  }
+  copy = string_view_to_buffer(values[0]);
+  if (copy.count != values[0].count || strcmp(copy.data, "common.h") != 0) {
+    return_defer(EXIT_FAILURE);
+  }
+defer:
+  buffer_free(&buffer);
+  buffer_free(&copy);
+  return result;
+}
@@ -0,0 +1,168 @@
+// test_hash.c
+
+#include "test_common.h"
+
+#define COMMON_IMPLEMENTATION
+#include "common.h"
+
+#define BUFFER_IMPL
+#include "buffer.h"
+
+#define HASH_IMPLEMENTATION
+#include "hash.h"
+
+#define DATA_SIZE 100000
+#define SPLIT_COUNT 16
+#define DISTRIBUTION_COUNT 100000
+
+i32 test(void);
+i32 test_known(void);
+i32 test_streaming(void);
+i32 test_distribution(void);
+i32 compare_u64(const void* a, const void* b);
+
+u8 data[DATA_SIZE] = {0};
+
+// computed with NO_SIMD, so the vectorized path has to produce the exact same values
+const size_t known_count[] = { 0, 3, 8, 16, 17, 100, 256, 257, 1000, 4109, 100000, };
+const u64 known_hash[][2] = {
+  { 0x1d14a72e0bcba494ull, 0xbfe7993712ac8131ull, },
+  { 0x72c7b0c13f9f266eull, 0x75f50e6c4facd08full, },
+  { 0xfb93bdbd0c9acc5dull, 0xd8cb29209c48bfbfull, },
+  { 0xdfe7fa6210d7e754ull, 0x2e9a9f79e4ad023aull, },
+  { 0xbf573e2177651fd0ull, 0xd9abfb467f229ecdull, },
+  { 0x0ed4c1d730566e2eull, 0xc05277b69c1b154dull, },
+  { 0xbd79a92ad863553bull, 0x4e708e85833d0cdcull, },
+  { 0xac3dc85768aebdb5ull, 0x883e6f6d49ff66cbull, },
+  { 0x1709e7ac058688baull, 0xcc740ad6f705718eull, },
+  { 0x2550a23a4cfde7fbull, 0x2109da14b866aa7aull, },
+  { 0x35176d05314abf83ull, 0x91a900050eed955aull, },
+};
+
+i32 main(void) {
+  return test();
+}
+
+i32 compare_u64(const void* a, const void* b) {
+  u64 x = *(const u64*)a;
+  u64 y = *(const u64*)b;
+  return (x > y) - (x < y);
+}
+
+i32 test(void) {
+  i32 result = EXIT_SUCCESS;
+  for (size_t i = 0; i < DATA_SIZE; ++i) {
+    data[i] = (u8)(i * 31 + 7);
+  }
+  if (test_known() != EXIT_SUCCESS) {
+    verbose_printf("known values failed\n");
+    return_defer(EXIT_FAILURE);
+  }
+  if (test_streaming() != EXIT_SUCCESS) {
+    verbose_printf("streaming failed\n");
+    return_defer(EXIT_FAILURE);
+  }
+  if (test_distribution() != EXIT_SUCCESS) {
+    verbose_printf("distribution failed\n");
+    return_defer(EXIT_FAILURE);
+  }
+defer:
+  return result;
+}
+
+i32 test_known(void) {
+  i32 result = EXIT_SUCCESS;
+  Buffer buffer = buffer_new_from_str("hello, world");
+  for (size_t i = 0; i < LENGTH(known_count); ++i) {
+    u64 h = hash64(data, known_count[i]);
+    u64 h_seed = hash64_seed(data, known_count[i], 42);
+    verbose_printf("%6zu: %016llx %016llx\n", known_count[i], (unsigned long long)h, (unsigned long long)h_seed);
+    if (h != known_hash[i][0] || h_seed != known_hash[i][1]) {
+      return_defer(EXIT_FAILURE);
+    }
+    if (hash64_seed(data, known_count[i], 0) != h) {
+      return_defer(EXIT_FAILURE);
+    }
+  }
+  if (hash_buffer(&buffer) != hash_str("hello, world")) {
+    return_defer(EXIT_FAILURE);
+  }
+  if (hash_string_view(string_view_slice(string_view_from_buffer(&buffer), 7, 5)) != hash_str("world")) {
+    return_defer(EXIT_FAILURE);
+  }
+defer:
+  buffer_free(&buffer);
+  return result;
+}
+
+// any way of splitting the input has to give the same hash as hashing it in one go
+i32 test_streaming(void) {
+  u32 state = 1234;
+  for (size_t count = 0; count < 2048; count += (count < 300 ? 1 : 7)) {
+    for (u64 seed = 0; seed < 2; ++seed) {
+      const u64 expected = hash64_seed(data, count, seed * 0x1234567);
+      for (size_t split = 0; split < SPLIT_COUNT; ++split) {
+        Hash_state hash = hash_state_new(seed * 0x1234567);
+        size_t offset = 0;
+        while (offset < count) {
+          state = state * 1664525u + 1013904223u;
+          size_t n = MIN((size_t)(state >> 8) % (split * 40 + 1) + 1, count - offset);
+          hash_update(&hash, &data[offset], n);
+          offset += n;
+          if (hash_digest(&hash) != hash64_seed(data, offset, seed * 0x1234567)) {
+            return EXIT_FAILURE;
+          }
+        }
+        if (hash_digest(&hash) != expected) {
+          return EXIT_FAILURE;
+        }
+      }
+    }
+  }
+  Hash_state hash = hash_state_new(0);
+  for (size_t offset = 0; offset < DATA_SIZE; offset += 1000) {
+    hash_update(&hash, &data[offset], 1000);
+  }
+  return hash_digest(&hash) == hash64(data, DATA_SIZE) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// no collisions on sequential keys, every output bit is set about half of the time, and flipping one input bit flips about half of the output bits
+i32 test_distribution(void) {
+  static u64 hashes[DISTRIBUTION_COUNT] = {0};
+  size_t bit_count[64] = {0};
+  for (u64 i = 0; i < DISTRIBUTION_COUNT; ++i) {
+    hashes[i] = hash64(&i, sizeof(i));
+    for (size_t bit = 0; bit < 64; ++bit) {
+      bit_count[bit] += (hashes[i] >> bit) & 1;
+    }
+  }
+  for (size_t bit = 0; bit < 64; ++bit) {
+    if (bit_count[bit] < DISTRIBUTION_COUNT * 48 / 100 || bit_count[bit] > DISTRIBUTION_COUNT * 52 / 100) {
+      return EXIT_FAILURE;
+    }
+  }
+  qsort(hashes, DISTRIBUTION_COUNT, sizeof(u64), compare_u64);
+  for (size_t i = 1; i < DISTRIBUTION_COUNT; ++i) {
+    if (hashes[i] == hashes[i - 1]) {
+      return EXIT_FAILURE;
+    }
+  }
+  const size_t sizes[] = { 5, 16, 40, 200, 1000, };
+  u8 input[1000] = {0};
+  for (size_t i = 0; i < LENGTH(sizes); ++i) {
+    memcpy(input, data, sizes[i]);
+    const u64 h = hash64(input, sizes[i]);
+    size_t flipped = 0;
+    for (size_t bit = 0; bit < sizes[i] * 8; ++bit) {
+      input[bit / 8] ^= 1 << (bit % 8);
+      flipped += __builtin_popcountll(h ^ hash64(input, sizes[i]));
+      input[bit / 8] ^= 1 << (bit % 8);
+    }
+    const f64 average = (f64)flipped / (sizes[i] * 8);
+    verbose_printf("avalanche %4zu bytes: %.2f bits\n", sizes[i], average);
+    if (average < 30 || average > 34) {
+      return EXIT_FAILURE;
+    }
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,73 @@
+// test_pool.c
+
+#include "test_common.h"
+
+#define COMMON_IMPLEMENTATION
+#include "common.h"
+
+#define ARENA_IMPLEMENTATION
+#include "arena.h"
+
+#define POOL_IMPLEMENTATION
+#include "pool.h"
+
+#define NODE_COUNT 1000
+
+typedef struct Node {
+  struct Node* next;
+  i32 value;
+} Node;
+
+i32 test(void);
+
+i32 main(void) {
+  return test();
+}
+
+i32 test(void) {
+  i32 result = EXIT_SUCCESS;
+  Arena arena = arena_new_chained(Kb(1));
+  Pool pool = pool_new_type(&arena, Node);
+  Node* list = NULL;
+  for (i32 i = 0; i < NODE_COUNT; ++i) {
+    Node* node = (Node*)pool_alloc(&pool);
+    if (!node || (uintptr_t)node % ARENA_ALIGNOF(Node)) {
+      return_defer(EXIT_FAILURE);
+    }
+    node->value = i;
+    node->next = list;
+    list = node;
+  }
+  if (pool.count != NODE_COUNT) {
+    return_defer(EXIT_FAILURE);
+  }
+  // free every other node, the freed slots should be handed out again before the arena is touched
+  Node* freed[NODE_COUNT / 2] = {0};
+  size_t freed_count = 0;
+  size_t arena_index = arena.index;
+  Arena_block* arena_block = arena.block;
+  for (Node* node = list; node && node->next; node = node->next) {
+    Node* next = node->next;
+    node->next = next->next;
+    freed[freed_count++] = next;
+    pool_free(&pool, next);
+  }
+  verbose_printf("freed %zu nodes, %zu in use\n", freed_count, pool.count);
+  for (size_t i = 0; i < freed_count; ++i) {
+    Node* node = (Node*)pool_alloc(&pool);
+    if (node != freed[freed_count - i - 1]) {
+      return_defer(EXIT_FAILURE);
+    }
+  }
+  if (arena.index != arena_index || arena.block != arena_block) {
+    return_defer(EXIT_FAILURE);
+  }
+  for (Node* node = list; node; node = node->next) {
+    if (node->value % 2 != (NODE_COUNT - 1) % 2) {
+      return_defer(EXIT_FAILURE);
+    }
+  }
+defer:
+  arena_free(&arena);
+  return result;
+}
@@ -0,0 +1,132 @@
+// test_rope.c
+
+#include "test_common.h"
+
+#define COMMON_IMPLEMENTATION
+#include "common.h"
+
+#define ARENA_IMPLEMENTATION
+#include "arena.h"
+
+#define POOL_IMPLEMENTATION
+#include "pool.h"
+
+#define BUFFER_IMPL
+#include "buffer.h"
+
+// small leaves so that the tree gets deep
+#define ROPE_LEAF_SIZE 64
+#define ROPE_IMPLEMENTATION
+#include "rope.h"
+
+#define EDIT_COUNT 20000
+
+i32 test(void);
+i32 compare(const Rope* rope, const Buffer* expected);
+
+i32 main(void) {
+  return test();
+}
+
+// same text, same line index and a balanced tree
+i32 compare(const Rope* rope, const Buffer* expected) {
+  if (rope_count(rope) != expected->count) {
+    return EXIT_FAILURE;
+  }
+  Buffer text = rope_to_buffer(rope);
+  i32 result = memcmp(text.data, expected->data, expected->count) == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+  buffer_free(&text);
+  size_t line = 0;
+  for (size_t i = 0; i < expected->count && result == EXIT_SUCCESS; ++i) {
+    if (rope_line_of(rope, i) != line || rope_at(rope, i) != expected->data[i]) {
+      result = EXIT_FAILURE;
+    }
+    if (expected->data[i] == '\n') {
+      line += 1;
+      if (rope_line_start(rope, line) != i + 1) {
+        result = EXIT_FAILURE;
+      }
+    }
+  }
+  if (rope_line_count(rope) != line + 1) {
+    return EXIT_FAILURE;
+  }
+  // an avl tree is never more than about 1.44 log2(n) high, and there are no more leaves than bytes
+  u32 max_height = 2;
+  for (size_t leaves = expected->count; leaves > 1; leaves >>= 1) {
+    max_height += 2;
+  }
+  if (rope->root && rope->root->height > max_height) {
+    return EXIT_FAILURE;
+  }
+  return result;
+}
+
+i32 test(void) {
+  i32 result = EXIT_SUCCESS;
+  Arena arena = arena_new_chained(Kb(64));
+  Rope_allocator allocator = rope_allocator_new(&arena);
+  Rope rope = rope_new(&allocator);
+  Rope tail = rope_new(&allocator);
+  Buffer expected = buffer_new(0);
+  char text[256] = {0};
+  u32 state = 4321;
+  for (i32 i = 0; i < EDIT_COUNT; ++i) {
+    state = state * 1664525u + 1013904223u;
+    u32 r = state >> 8;
+    size_t count = expected.count;
+    size_t index = count ? r % (count + 1) : 0;
+    if (r % 3 == 0 && count > 0) {
+      size_t n = MIN((size_t)(r >> 12) % 8 + 1, count - index);
+      rope_erase(&rope, index, n);
+      memmove(&expected.data[index], &expected.data[index + n], count - index - n);
+      expected.count -= n;
+      expected.data[expected.count] = 0;
+    }
+    else {
+      size_t n = (r >> 12) % (i % 50 == 0 ? LENGTH(text) : 8) + 1;
+      for (size_t k = 0; k < n; ++k) {
+        state = state * 1664525u + 1013904223u;
+        text[k] = (state >> 24) % 8 == 0 ? '\n' : 'a' + (state >> 24) % 26;
+      }
+      rope_insert(&rope, text, n, index);
+      buffer_insert_n(&expected, text, n, index);
+    }
+  }
+  verbose_printf("rope: %zu bytes, %zu lines, height %u, %zu nodes\n", rope_count(&rope), rope_line_count(&rope), rope.root ? rope.root->height : 0, allocator.nodes.count);
+  if (compare(&rope, &expected) != EXIT_SUCCESS) {
+    return_defer(EXIT_FAILURE);
+  }
+
+  // split in the middle and put the halves back together in the other order
+  size_t half = expected.count / 2;
+  tail = rope_split(&rope, half);
+  if (rope_count(&rope) != half || rope_count(&tail) != expected.count - half) {
+    return_defer(EXIT_FAILURE);
+  }
+  rope_concat(&tail, &rope);
+  Buffer swapped = buffer_new(0);
+  buffer_append_n(&swapped, &expected.data[half], expected.count - half);
+  buffer_append_n(&swapped, expected.data, half);
+  i32 swapped_result = compare(&tail, &swapped);
+  buffer_free(&swapped);
+  if (swapped_result != EXIT_SUCCESS || rope_count(&rope) != 0) {
+    return_defer(EXIT_FAILURE);
+  }
+
+  // every node goes back to the pools
+  rope_free(&tail);
+  if (allocator.nodes.count != 0 || allocator.chunks.count != 0) {
+    return_defer(EXIT_FAILURE);
+  }
+  rope = rope_new_from_buffer(&allocator, &expected);
+  if (compare(&rope, &expected) != EXIT_SUCCESS) {
+    return_defer(EXIT_FAILURE);
+  }
+defer:
+  rope_free(&rope);
+  rope_free(&tail);
+  buffer_free(&expected);
+  arena_free(&arena);
+  return result;
+}
@@ -0,0 +1,167 @@
+// test_slab.c
+
+#include "test_common.h"
+
+#define COMMON_IMPLEMENTATION
+#include "common.h"
+
+#define THREAD_IMPLEMENTATION
+#include "thread.h"
+
+#define ARENA_IMPLEMENTATION
+#include "arena.h"
+
+#define SLAB_IMPLEMENTATION
+#include "slab.h"
+
+#define THREAD_COUNT NPROC
+#define ALLOCATION_COUNT 4096
+#define REMOTE_SIZE 12000 // a size class that none of the other tests use
+#define REMOTE_COUNT (2 * SLAB_BATCH_COUNT - 1)
+
+typedef struct Handle {
+  i32 result;
+  i32 index; // set before the thread starts, unlike id
+  i32 id;
+} Handle;
+
+i32 test(void);
+i32 test_sizes(u8 seed);
+i32 test_remote_free(void);
+void* work(Handle* handle);
+void* free_all(void** items);
+
+i32 main(void) {
+  return test();
+}
+
+i32 test(void) {
+  thread_init();
+  slab_install();
+  if (arena_memory_malloc != slab_malloc) {
+    return EXIT_FAILURE;
+  }
+  // n * size does not fit in a size_t, must fail instead of handing out a short allocation
+  if (slab_calloc(SIZE_MAX / 8 + 2, 8) != NULL) {
+    return EXIT_FAILURE;
+  }
+  if (test_remote_free() != EXIT_SUCCESS) {
+    return EXIT_FAILURE;
+  }
+  if (test_sizes(1) != EXIT_SUCCESS) {
+    return EXIT_FAILURE;
+  }
+  Handle handles[THREAD_COUNT] = {0};
+  for (size_t i = 0; i < THREAD_COUNT; ++i) {
+    Handle* handle = &handles[i];
+    handle->result = EXIT_FAILURE;
+    handle->index = (i32)i;
+    if ((handle->id = thread_create_v2((void*)work, handle)) < 0) {
+      return EXIT_FAILURE;
+    }
+  }
+  for (size_t i = 0; i < THREAD_COUNT; ++i) {
+    thread_join(handles[i].id);
+    if (handles[i].result != EXIT_SUCCESS) {
+      return EXIT_FAILURE;
+    }
+  }
+  // arenas now take their blocks from the slab allocator
+  Arena arena = arena_new_chained(100);
+  for (i32 i = 0; i < 100; ++i) {
+    memset(arena_alloc(&arena, 64), i, 64);
+  }
+  arena_free(&arena);
+  Slab_stats stats = slab_stats();
+  verbose_printf("slabs: %zu, large allocations: %zu (%zu bytes)\n", stats.slab_count, stats.large_count, stats.large_bytes);
+  if (stats.large_count != 0) {
+    return EXIT_FAILURE;
+  }
+  slab_flush();
+  slab_destroy();
+  return EXIT_SUCCESS;
+}
+
+// allocate a spread of sizes, fill every allocation with a pattern and check that nothing overlaps
+i32 test_sizes(u8 seed) {
+  i32 result = EXIT_SUCCESS;
+  u8** items = (u8**)slab_calloc(ALLOCATION_COUNT, sizeof(u8*));
+  size_t* sizes = (size_t*)slab_malloc(ALLOCATION_COUNT * sizeof(size_t));
+  for (size_t i = 0; i < ALLOCATION_COUNT; ++i) {
+    sizes[i] = 1 + (i * 37) % 2048;
+    if (i % 512 == 0) {
+      sizes[i] = SLAB_MAX_SIZE + i;
+    }
+    items[i] = (u8*)slab_malloc(sizes[i]);
+    if (!items[i] || slab_usable_size(items[i]) < sizes[i] || (uintptr_t)items[i] % 16) {
+      return_defer(EXIT_FAILURE);
+    }
+    memset(items[i], (u8)(seed + i), sizes[i]);
+  }
+  // grow every other allocation, the contents must be kept
+  for (size_t i = 0; i < ALLOCATION_COUNT; i += 2) {
+    items[i] = (u8*)slab_realloc(items[i], sizes[i] * 3);
+    memset(items[i] + sizes[i], (u8)(seed + i), sizes[i] * 2);
+    sizes[i] *= 3;
+  }
+  for (size_t i = 0; i < ALLOCATION_COUNT; ++i) {
+    for (size_t j = 0; j < sizes[i]; ++j) {
+      if (items[i][j] != (u8)(seed + i)) {
+        return_defer(EXIT_FAILURE);
+      }
+    }
+  }
+defer:
+  for (size_t i = 0; i < ALLOCATION_COUNT; ++i) {
+    slab_free(items[i]);
+  }
+  slab_free(items);
+  slab_free(sizes);
+  return result;
+}
+
+void* work(Handle* handle) {
+  handle->result = EXIT_SUCCESS;
+  for (i32 i = 0; i < 4; ++i) {
+    if (test_sizes((u8)(handle->index * 4 + i)) != EXIT_SUCCESS) {
+      handle->result = EXIT_FAILURE;
+    }
+  }
+  return NULL;
+}
+
+void* free_all(void** items) {
+  for (size_t i = 0; i < REMOTE_COUNT; ++i) {
+    slab_free(items[i]);
+  }
+  return NULL;
+}
+
+// a thread that only frees what another thread allocated still hands its cache back when it exits,
+// so allocating the same objects again does not need any new slabs
+i32 test_remote_free(void) {
+  void* items[REMOTE_COUNT] = {0};
+  for (size_t i = 0; i < REMOTE_COUNT; ++i) {
+    if (!(items[i] = slab_malloc(REMOTE_SIZE))) {
+      return EXIT_FAILURE;
+    }
+  }
+  i32 id = thread_create_v2((void*)free_all, items);
+  if (id < 0) {
+    return EXIT_FAILURE;
+  }
+  thread_join(id);
+  slab_flush();
+  size_t slab_count = slab_stats().slab_count;
+  for (size_t i = 0; i < REMOTE_COUNT; ++i) {
+    if (!(items[i] = slab_malloc(REMOTE_SIZE))) {
+      return EXIT_FAILURE;
+    }
+  }
+  verbose_printf("slabs before: %zu, after: %zu\n", slab_count, slab_stats().slab_count);
+  if (slab_stats().slab_count != slab_count) {
+    return EXIT_FAILURE;
+  }
+  free_all(items);
+  return EXIT_SUCCESS;
+}